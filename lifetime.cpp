@@ -0,0 +1,30 @@
+/**
+ * @file lifetime.cpp
+ * @author Ty Qualters (contact@tyqualters.com)
+ * @brief Compiled part of lifetime.hpp for LIFETIME_COMPILED_LIB builds
+ * @version 0.1
+ * @date 2022-12-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+// Build this file with the same LIFETIME_* options as the code that includes lifetime.hpp.
+// It holds the out-of-line slow paths and the Lifetime<T> specialisations declared
+// extern template at the end of the header.
+
+#if !defined(LIFETIME_COMPILED_LIB)
+#define LIFETIME_COMPILED_LIB
+#endif
+#define LIFETIME_IMPLEMENTATION
+
+#include "lifetime.hpp"
+
+template class Lifetime<int>;
+template class Lifetime<unsigned int>;
+template class Lifetime<long>;
+template class Lifetime<unsigned long>;
+template class Lifetime<long long>;
+template class Lifetime<unsigned long long>;
+template class Lifetime<std::string>;
+template class Lifetime<std::vector<std::byte>>;
@@ -0,0 +1,177 @@
+/**
+ * @file lifetime.cppm
+ * @author Ty Qualters (contact@tyqualters.com)
+ * @brief C++20 named module `lifetime`, exporting the API of lifetime.hpp
+ * @version 0.1
+ * @date 2022-12-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+// The LIFETIME_* options are fixed when the module interface is compiled: build it with the
+// same -D flags as its importers. Only the opt-in namespaces that were enabled are exported.
+
+module;
+
+#include "lifetime.hpp"
+#include "lifetime_array.hpp"
+#include "lifetime_bulk.hpp"
+#include "lifetime_args.hpp"
+
+export module lifetime;
+
+export using ::Lifetime;
+export using ::LifetimeSlice;
+export using ::LifetimeRange;
+export using ::lifetime_traits;
+export using ::lifetime_site;
+export using ::lifetime_violation;
+export using ::lifetime_violation_name;
+export using ::lifetime_op;
+export using ::lifetime_op_name;
+export using ::lifetime_check_level;
+#if defined(__cpp_constexpr_dynamic_alloc)
+export using ::ConstexprLifetime;
+#endif
+#if defined(LIFETIME_SOURCE_LOCATION)
+export using ::get_source_position;
+#endif
+
+export namespace lifetime_checks {
+    using lifetime_checks::set_level;
+    using lifetime_checks::level;
+    using lifetime_checks::violation_handler;
+    using lifetime_checks::set_violation_handler;
+    using lifetime_checks::last_violation;
+    using lifetime_checks::clear_last_violation;
+}
+
+export namespace lifetime_args {
+    using lifetime_args::mutable_arg;
+    using lifetime_args::mut;
+    using lifetime_args::access;
+}
+
+export namespace lifetime_bulk {
+    using lifetime_bulk::for_each;
+    using lifetime_bulk::transform;
+    using lifetime_bulk::reduce;
+}
+
+export namespace lifetime_static {
+    using lifetime_static::Owned;
+    using lifetime_static::Borrowed;
+    using lifetime_static::MutBorrowed;
+}
+
+#if defined(LIFETIME_STATS)
+export namespace lifetime_stats {
+    using lifetime_stats::counters;
+    using lifetime_stats::snapshot;
+#if defined(LIFETIME_TYPE_STATS)
+    using lifetime_stats::type_counters;
+    using lifetime_stats::by_type;
+#endif
+}
+#endif
+
+#if defined(LIFETIME_PROFILE_LOCKS)
+export namespace lifetime_profile {
+    using lifetime_profile::contention_report;
+    using lifetime_profile::set_sample_rate;
+    using lifetime_profile::sample_rate;
+    using lifetime_profile::top_contended;
+    using lifetime_profile::retired;
+    using lifetime_profile::report;
+}
+#endif
+
+#if defined(LIFETIME_TRACK_BORROWS)
+export namespace lifetime_long_borrows {
+    using lifetime_long_borrows::long_borrow;
+    using lifetime_long_borrows::handler_t;
+    using lifetime_long_borrows::set_threshold;
+    using lifetime_long_borrows::threshold;
+    using lifetime_long_borrows::set_handler;
+    using lifetime_long_borrows::flagged;
+    using lifetime_long_borrows::outstanding;
+    using lifetime_long_borrows::recent;
+    using lifetime_long_borrows::report;
+}
+#endif
+
+#if defined(LIFETIME_TRACE)
+export namespace lifetime_trace {
+    using lifetime_trace::span;
+    using lifetime_trace::start;
+    using lifetime_trace::stop;
+    using lifetime_trace::is_enabled;
+    using lifetime_trace::clear;
+    using lifetime_trace::write;
+}
+#endif
+
+#if defined(LIFETIME_SAMPLED_CHECKS)
+export namespace lifetime_sampling {
+    using lifetime_sampling::set_rate;
+    using lifetime_sampling::rate;
+}
+#endif
+
+#if defined(LIFETIME_REGISTRY)
+export namespace lifetime_debug {
+    using lifetime_debug::handle_state;
+    using lifetime_debug::object_state;
+    using lifetime_debug::live_count;
+    using lifetime_debug::live_objects;
+    using lifetime_debug::write_live_report;
+    using lifetime_debug::live_report;
+    using lifetime_debug::dump_graph;
+    using lifetime_debug::set_report_at_exit;
+}
+#endif
+
+#if defined(LIFETIME_HEAP_PROFILE)
+export namespace lifetime_heap {
+    using lifetime_heap::site_usage;
+    using lifetime_heap::top_sites;
+    using lifetime_heap::report;
+}
+#endif
+
+#if defined(LIFETIME_RECORD)
+export namespace lifetime_record {
+    using lifetime_record::event;
+    using lifetime_record::file_header;
+    using lifetime_record::start;
+    using lifetime_record::stop;
+    using lifetime_record::is_enabled;
+    using lifetime_record::dropped;
+    using lifetime_record::clear;
+    using lifetime_record::events;
+    using lifetime_record::write;
+    using lifetime_record::read;
+    using lifetime_record::replay_result;
+    using lifetime_record::replayer;
+}
+#endif
+
+#if defined(LIFETIME_OP_TIMERS)
+export namespace lifetime_timers {
+    using lifetime_timers::latency_summary;
+    using lifetime_timers::bucket;
+    using lifetime_timers::uses_tsc;
+    using lifetime_timers::ns_per_tick;
+    using lifetime_timers::buckets;
+    using lifetime_timers::summary;
+    using lifetime_timers::report;
+}
+#endif
+
+#if defined(LIFETIME_STATS) || defined(LIFETIME_PROFILE_LOCKS)
+export namespace lifetime_metrics {
+    using lifetime_metrics::write_prometheus;
+    using lifetime_metrics::prometheus_text;
+}
+#endif
@@ -14,236 +14,3537 @@
 #ifndef CPP_LIFETIME_H_
 #define CPP_LIFETIME_H_
 
-#include <sstream>
-#include <stdexcept>
-// #include <source_location> (since C++20)
+#include "lifetime_fwd.hpp"
+
+// Options implied by other options come first, so every include below sees the final set
+
+// Violations throw std::runtime_error unless exceptions are disabled (-fno-exceptions); then
+// they go to lifetime_checks' violation handler, which by default prints and aborts
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+#define LIFETIME_EXCEPTIONS
+#endif
+
+// std::source_location needs C++20 and a standard library that has it
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined(__cpp_lib_source_location)
+#define LIFETIME_HAS_SOURCE_LOCATION
+#endif
+
+// Source locations are captured in checked (non-NDEBUG) builds unless LIFETIME_NO_SOURCE_LOCATION is
+// defined; without std::source_location, lifetime_site stays empty
+#if !defined(LIFETIME_SOURCE_LOCATION) && !defined(NDEBUG) && !defined(LIFETIME_NO_SOURCE_LOCATION) && defined(LIFETIME_HAS_SOURCE_LOCATION)
+#define LIFETIME_SOURCE_LOCATION
+#endif
+
+// The heap profile is keyed by creation site, so it always captures them
+#if defined(LIFETIME_HEAP_PROFILE) && !defined(LIFETIME_SOURCE_LOCATION)
+#if !defined(LIFETIME_HAS_SOURCE_LOCATION)
+#error "LIFETIME_HEAP_PROFILE needs std::source_location (C++20)"
+#endif
+#define LIFETIME_SOURCE_LOCATION
+#endif
+
+// Contention and long-borrow reports name creation sites and holders, so they capture them too
+// where std::source_location exists
+#if (defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_TRACK_BORROWS)) && !defined(LIFETIME_SOURCE_LOCATION) && defined(LIFETIME_HAS_SOURCE_LOCATION)
+#define LIFETIME_SOURCE_LOCATION
+#endif
+
+// Per-type counters extend the global ones
+#if defined(LIFETIME_TYPE_STATS) && !defined(LIFETIME_STATS)
+#define LIFETIME_STATS
+#endif
+
+#if defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_SOURCE_LOCATION) || defined(LIFETIME_REGISTRY) || defined(LIFETIME_TYPE_STATS) || defined(LIFETIME_HEAP_PROFILE) || defined(LIFETIME_RECORD)
+#define LIFETIME_CONTROL_INFO
+#endif
+
+// Borrow handles remember when (and on which thread) they were taken
+#if defined(LIFETIME_TRACK_BORROWS) || defined(LIFETIME_TRACE)
+#define LIFETIME_STAMP_BORROWS
+#endif
+
+#include <string>
 #include <set>
 #include <utility>
 #include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <type_traits>
+
+#if defined(LIFETIME_EXCEPTIONS)
+#include <stdexcept>
+#else
+#include <cstdlib>
+#endif
+
+#if defined(LIFETIME_SOURCE_LOCATION)
+#include <source_location>
+#endif
+
+// Only the opt-in reports format text through streams
+#if defined(LIFETIME_STATS) || defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_TRACK_BORROWS) || defined(LIFETIME_TRACE) || defined(LIFETIME_REGISTRY) || defined(LIFETIME_HEAP_PROFILE) || defined(LIFETIME_RECORD) || defined(LIFETIME_OP_TIMERS)
+#include <sstream>
+#endif
+
+#if defined(LIFETIME_STATS) || defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_STAMP_BORROWS) || defined(LIFETIME_SAMPLED_CHECKS) || defined(LIFETIME_REGISTRY) || defined(LIFETIME_HEAP_PROFILE) || defined(LIFETIME_RECORD) || defined(LIFETIME_OP_TIMERS)
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#endif
+
+#if defined(LIFETIME_HEAP_PROFILE) || defined(LIFETIME_RECORD)
+#include <map>
+#endif
+
+#if defined(LIFETIME_CONTROL_INFO) || defined(LIFETIME_STAMP_BORROWS)
+#include <typeinfo>
+#if defined(__has_include)
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#include <cstdlib>
+#define LIFETIME_HAS_CXXABI
+#endif
+#endif
+#endif
+
+#if defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_STAMP_BORROWS) || defined(LIFETIME_RECORD) || defined(LIFETIME_OP_TIMERS)
+#include <chrono>
+#endif
+
+// Hot-path timers read the TSC on x86 unless LIFETIME_OP_TIMERS_NO_TSC is defined
+#if defined(LIFETIME_OP_TIMERS) && !defined(LIFETIME_OP_TIMERS_NO_TSC) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64))
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define LIFETIME_OP_TIMERS_TSC
+#endif
+
+// LIFETIME_COMPILED_LIB: the slow paths (violation reporting, the live registry, tracing and
+// recording) and the common Lifetime<T> specialisations are compiled once, in lifetime.cpp,
+// instead of in every translation unit. Every TU and lifetime.cpp must use the same options.
+#if defined(LIFETIME_COMPILED_LIB)
+#define LIFETIME_OUT_OF_LINE
+#include <cstddef>
+#include <vector>
+#else
+#define LIFETIME_OUT_OF_LINE inline
+#endif
+
+// Rarely taken paths, kept out of the callers' inlined fast paths
+#if defined(__GNUC__)
+#define LIFETIME_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define LIFETIME_COLD __declspec(noinline)
+#else
+#define LIFETIME_COLD
+#endif
+
+// Bulk kernels promise their input and output do not overlap
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define LIFETIME_RESTRICT __restrict
+#else
+#define LIFETIME_RESTRICT
+#endif
+
+// Member constraints where the compiler has concepts; C++17 builds leave them unconstrained
+#if defined(__cpp_concepts)
+#define LIFETIME_REQUIRES(...) requires (__VA_ARGS__)
+#else
+#define LIFETIME_REQUIRES(...)
+#endif
+
+#if defined(LIFETIME_TRACE) || defined(LIFETIME_STATS) || defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_RECORD)
+#include <fstream>
+#include <cstdio>
+#endif
+
+#if defined(LIFETIME_REGISTRY)
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+// USDT tracepoints (define LIFETIME_USDT; needs <sys/sdt.h> from systemtap-sdt-dev)
+// Probes in provider "lifetime": create(id, type, size), borrow(id, handle, handles),
+// borrow_mutable(id, handle, handles), release(id, handle), move(id, new_owner),
+// destroy(id), violation(kind, message). Unattached probes are a single nop.
+#if defined(LIFETIME_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#include <typeinfo>
+#define LIFETIME_PROBE1(name, a) DTRACE_PROBE1(lifetime, name, a)
+#define LIFETIME_PROBE2(name, a, b) DTRACE_PROBE2(lifetime, name, a, b)
+#define LIFETIME_PROBE3(name, a, b, c) DTRACE_PROBE3(lifetime, name, a, b, c)
+#endif
+#endif
+
+#if !defined(LIFETIME_PROBE1)
+#define LIFETIME_PROBE1(name, a) ((void)0)
+#define LIFETIME_PROBE2(name, a, b) ((void)0)
+#define LIFETIME_PROBE3(name, a, b, c) ((void)0)
+#endif
+
+// Kinds of borrow/ownership violations
+enum class lifetime_violation : unsigned {
+    owner_freed_with_references,
+    mutable_without_ownership,
+    write_without_ownership,
+    mutable_borrow_exists,
+    move_without_ownership,
+    move_to_self,
+    move_to_foreign,
+    aliased_mutable_argument,
+    slice_out_of_range,
+    modified_during_range,
+    count
+};
+
+constexpr auto lifetime_violation_name(lifetime_violation kind) noexcept -> const char*
+{
+    switch(kind)
+    {
+        case lifetime_violation::owner_freed_with_references: return "owner_freed_with_references";
+        case lifetime_violation::mutable_without_ownership: return "mutable_without_ownership";
+        case lifetime_violation::write_without_ownership: return "write_without_ownership";
+        case lifetime_violation::mutable_borrow_exists: return "mutable_borrow_exists";
+        case lifetime_violation::move_without_ownership: return "move_without_ownership";
+        case lifetime_violation::move_to_self: return "move_to_self";
+        case lifetime_violation::move_to_foreign: return "move_to_foreign";
+        case lifetime_violation::aliased_mutable_argument: return "aliased_mutable_argument";
+        case lifetime_violation::slice_out_of_range: return "slice_out_of_range";
+        case lifetime_violation::modified_during_range: return "modified_during_range";
+        default: return "unknown";
+    }
+}
+
+// Operations logged by the recorder (LIFETIME_RECORD)
+enum class lifetime_op : unsigned char {
+    create,
+    borrow,
+    borrow_mutable,
+    // A new handle took ownership (move())
+    move,
+    // An existing handle took ownership (move(Lifetime&))
+    move_to,
+    get,
+    get_mutable,
+    set,
+    release,
+    violation,
+    count
+};
+
+constexpr auto lifetime_op_name(lifetime_op op) noexcept -> const char*
+{
+    switch(op)
+    {
+        case lifetime_op::create: return "create";
+        case lifetime_op::borrow: return "borrow";
+        case lifetime_op::borrow_mutable: return "borrow_mutable";
+        case lifetime_op::move: return "move";
+        case lifetime_op::move_to: return "move_to";
+        case lifetime_op::get: return "get";
+        case lifetime_op::get_mutable: return "get_mutable";
+        case lifetime_op::set: return "set";
+        case lifetime_op::release: return "release";
+        case lifetime_op::violation: return "violation";
+        default: return "unknown";
+    }
+}
+
+// How much checking Lifetimes do, switchable at runtime
+// off:      violations are ignored
+// counters: handles are only counted; violations are reported without details
+// full:     handles are tracked by identity; violations name the sites involved
+enum class lifetime_check_level : int {
+    off,
+    counters,
+    full
+};
+
+namespace lifetime_checks {
+
+    namespace detail {
+
+        static_assert(std::atomic<lifetime_check_level>::is_always_lock_free);
+
+        auto inline level_cell() noexcept -> std::atomic<lifetime_check_level>&
+        {
+            static std::atomic<lifetime_check_level> level{lifetime_check_level::full};
+            return level;
+        }
+    }
+
+    // Receives every reported violation. If it returns, the operation goes ahead as it would
+    // with checking off, and last_violation() tells the caller what happened.
+    using violation_handler = void (*)(lifetime_violation kind, const char* what);
+
+    namespace detail {
+
+        LIFETIME_COLD auto LIFETIME_OUT_OF_LINE default_handler([[maybe_unused]] lifetime_violation kind, const char* what) -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+        {
+#if defined(LIFETIME_EXCEPTIONS)
+            throw std::runtime_error(what);
+#else
+            std::fprintf(stderr, "Lifetime violation (%s): %s\n", lifetime_violation_name(kind), what);
+            std::abort();
+#endif
+        }
+#else
+        ;
+#endif
+
+        auto inline handler_cell() noexcept -> std::atomic<violation_handler>&
+        {
+            static std::atomic<violation_handler> handler{&default_handler};
+            return handler;
+        }
+
+        // lifetime_violation::count when there is none
+        auto inline last_violation_cell() noexcept -> lifetime_violation&
+        {
+            thread_local lifetime_violation last = lifetime_violation::count;
+            return last;
+        }
+
+        auto inline report(lifetime_violation kind, const char* what) -> void
+        {
+            last_violation_cell() = kind;
+            handler_cell().load(std::memory_order_acquire)(kind, what);
+        }
+    }
+
+    // Replace the violation handler (nullptr restores the default: throw, or print and abort
+    // without exceptions)
+    auto inline set_violation_handler(violation_handler handler) noexcept -> void
+    {
+        detail::handler_cell().store(handler == nullptr ? &detail::default_handler : handler, std::memory_order_release);
+    }
+
+    // Last violation reported on this thread (lifetime_violation::count if none since clear)
+    auto inline last_violation() noexcept -> lifetime_violation
+    {
+        return detail::last_violation_cell();
+    }
+
+    auto inline clear_last_violation() noexcept -> void
+    {
+        detail::last_violation_cell() = lifetime_violation::count;
+    }
+
+    // Lock-free, so it may be called from a signal handler. Tracking is decided when a
+    // Lifetime is created; reporting when a violation happens.
+    auto inline set_level(lifetime_check_level level) noexcept -> void
+    {
+        detail::level_cell().store(level, std::memory_order_relaxed);
+    }
+
+    auto inline level() noexcept -> lifetime_check_level
+    {
+        return detail::level_cell().load(std::memory_order_relaxed);
+    }
+
+    // Set the level by name ("off", "counters" or "full"), e.g. from a control file
+    auto inline set_level(const char* name) noexcept -> bool
+    {
+        if(name == nullptr) return false;
+        if(std::strcmp(name, "off") == 0) set_level(lifetime_check_level::off);
+        else if(std::strcmp(name, "counters") == 0) set_level(lifetime_check_level::counters);
+        else if(std::strcmp(name, "full") == 0) set_level(lifetime_check_level::full);
+        else return false;
+        return true;
+    }
+}
+
+#if defined(LIFETIME_SOURCE_LOCATION)
+LIFETIME_COLD auto LIFETIME_OUT_OF_LINE get_source_position(const std::source_location location = std::source_location::current()) -> std::string
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+{
+    std::string out = "File: \t";
+    out += location.file_name();
+    out += "\nLine/Col: \t" + std::to_string(location.line()) + ", " + std::to_string(location.column());
+    out += "\nFunc: \t";
+    out += location.function_name();
+    out += "\n";
+    return out;
+}
+#else
+;
+#endif
+#endif
+
+// Where a Lifetime operation was called from (empty without LIFETIME_SOURCE_LOCATION)
+// A defaulted `lifetime_site site = lifetime_site()` parameter records the caller.
+struct lifetime_site {
+#if defined(LIFETIME_SOURCE_LOCATION)
+    std::source_location location;
+
+    constexpr lifetime_site(const std::source_location location = std::source_location::current()) noexcept : location(location) {}
+
+    auto to_string() const -> std::string
+    {
+        return get_source_position(this->location);
+    }
+#else
+    auto to_string() const -> std::string
+    {
+        return "(source location unavailable)\n";
+    }
+#endif
+};
+
+namespace lifetime_detail {
+
+    // How reports name and size the value of a Lifetime<T> (lifetime_array.hpp specialises it for
+    // the element block of a Lifetime<T[]>, which is reported as T[] with its elements' bytes)
+    template<class T>
+    struct value_report {
+        using type = T;
+
+        auto static size(const T&) noexcept -> std::size_t
+        {
+            return sizeof(T);
+        }
+    };
+
+    struct handle_access;
+
+    // Can a T be walked with std::begin / std::end?
+    template<class T, class = void>
+    inline constexpr bool is_iterable = false;
+
+    template<class T>
+    inline constexpr bool is_iterable<T, std::void_t<decltype(std::begin(std::declval<T&>())), decltype(std::end(std::declval<T&>()))>> = true;
+}
+
+#if defined(LIFETIME_CONTROL_INFO) || defined(LIFETIME_STAMP_BORROWS)
+namespace lifetime_detail {
+
+    // Readable name of T for reports (demangled where the ABI allows); never freed, so it
+    // stays valid for reports written at exit
+    template<class T>
+    auto type_name() -> const char*
+    {
+        static const std::string* const name = []() -> const std::string*
+        {
+            const char* mangled = typeid(typename value_report<T>::type).name();
+#if defined(LIFETIME_HAS_CXXABI)
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+            if(status == 0 && demangled != nullptr)
+            {
+                const std::string* out = new std::string(demangled);
+                std::free(demangled);
+                return out;
+            }
+#endif
+            return new std::string(mangled);
+        }();
+        return name->c_str();
+    }
+}
+#endif
+
+#if defined(LIFETIME_STATS) || defined(LIFETIME_TRACE) || defined(LIFETIME_RECORD) || defined(LIFETIME_OP_TIMERS)
+namespace lifetime_detail {
+
+    // Per-thread data (Local) of one report feature: live threads are listed here and an exiting
+    // thread folds its data into retired with Local::add_to(Retired&)
+    template<class Local, class Retired>
+    struct thread_registry {
+        using local_type = Local;
+
+        std::mutex mutex;
+        std::vector<Local*> threads;
+        // Data of threads that already exited
+        Retired retired{};
+    };
+
+    // Registers one thread's Local with Get() (a never-destroyed registry, so threads exiting
+    // after static destruction can still retire) for as long as the thread lives
+    template<auto Get>
+    struct thread_slot {
+        using registry_type = std::remove_reference_t<decltype(Get())>;
+
+        typename registry_type::local_type local;
+
+        thread_slot()
+        {
+            registry_type& r = Get();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            r.threads.push_back(&this->local);
+        }
+
+        ~thread_slot()
+        {
+            registry_type& r = Get();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            this->local.add_to(r.retired);
+            r.threads.erase(std::find(r.threads.begin(), r.threads.end(), &this->local));
+        }
+    };
+
+    // The calling thread's Local of Get()
+    template<auto Get>
+    auto thread_data() -> typename thread_slot<Get>::registry_type::local_type&
+    {
+        thread_local thread_slot<Get> slot;
+        return slot.local;
+    }
+}
+#endif
+
+#if defined(LIFETIME_STATS)
+// Global Lifetime counters (define LIFETIME_STATS to enable)
+// Each thread bumps its own relaxed counters; snapshot() merges them on read.
+namespace lifetime_stats {
+
+    struct counters {
+        std::uint64_t live = 0;
+        std::uint64_t created = 0;
+        std::uint64_t destroyed = 0;
+        std::uint64_t shared_borrows = 0;
+        std::uint64_t mutable_borrows = 0;
+        std::uint64_t violations[static_cast<unsigned>(lifetime_violation::count)] = {};
+        std::uint64_t peak_fan_out = 0;
+    };
+
+    namespace detail {
+
+        struct thread_counters {
+            std::atomic<std::uint64_t> created{0};
+            std::atomic<std::uint64_t> destroyed{0};
+            std::atomic<std::uint64_t> shared_borrows{0};
+            std::atomic<std::uint64_t> mutable_borrows{0};
+            std::atomic<std::uint64_t> violations[static_cast<unsigned>(lifetime_violation::count)] = {};
+            std::atomic<std::uint64_t> peak_fan_out{0};
+
+            auto add_to(counters& out) const noexcept -> void
+            {
+                out.created += this->created.load(std::memory_order_relaxed);
+                out.destroyed += this->destroyed.load(std::memory_order_relaxed);
+                out.shared_borrows += this->shared_borrows.load(std::memory_order_relaxed);
+                out.mutable_borrows += this->mutable_borrows.load(std::memory_order_relaxed);
+                for(unsigned i = 0; i < static_cast<unsigned>(lifetime_violation::count); ++i)
+                    out.violations[i] += this->violations[i].load(std::memory_order_relaxed);
+                out.peak_fan_out = std::max(out.peak_fan_out, this->peak_fan_out.load(std::memory_order_relaxed));
+            }
+        };
+
+        // Counters of live threads, plus the totals of threads that already exited
+        using registry = lifetime_detail::thread_registry<thread_counters, counters>;
+
+        auto inline get_registry() -> registry&
+        {
+            static registry* r = new registry;
+            return *r;
+        }
+
+        auto inline local() noexcept -> thread_counters&
+        {
+            return lifetime_detail::thread_data<&get_registry>();
+        }
+
+        // Only the owning thread writes, so a relaxed load + store is enough
+        auto inline bump(std::atomic<std::uint64_t>& counter) noexcept -> void
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        auto inline raise(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept -> void
+        {
+            if(value > counter.load(std::memory_order_relaxed)) counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    // Merge every thread's counters
+    auto inline snapshot() -> counters
+    {
+        detail::registry& r = detail::get_registry();
+        std::scoped_lock<std::mutex> lock(r.mutex);
+        counters out = r.retired;
+        for(const auto* thread : r.threads)
+            thread->add_to(out);
+        out.live = out.created >= out.destroyed ? out.created - out.destroyed : 0U;
+        return out;
+    }
+
+#if defined(LIFETIME_TYPE_STATS)
+    // Counters of every Lifetime<T> for one T (define LIFETIME_TYPE_STATS to enable)
+    // Unlike the global counters these are shared atomics, one set per instantiated T.
+    struct type_counters {
+        const char* type_name = nullptr;
+        // sizeof(T), or of one element for T[]
+        std::size_t size = 0U;
+        std::uint64_t live = 0;
+        std::uint64_t created = 0;
+        std::uint64_t destroyed = 0;
+        std::uint64_t live_bytes = 0;
+        std::uint64_t shared_borrows = 0;
+        std::uint64_t mutable_borrows = 0;
+        // Sampled lock waits (with LIFETIME_PROFILE_LOCKS)
+        std::uint64_t lock_samples = 0;
+        std::uint64_t lock_wait_ns = 0;
+    };
+
+    namespace detail {
+
+        struct type_entry {
+            const char* type_name = nullptr;
+            std::size_t size = 0U;
+            std::atomic<std::uint64_t> created{0};
+            std::atomic<std::uint64_t> destroyed{0};
+            std::atomic<std::uint64_t> live_bytes{0};
+            std::atomic<std::uint64_t> shared_borrows{0};
+            std::atomic<std::uint64_t> mutable_borrows{0};
+            std::atomic<std::uint64_t> lock_samples{0};
+            std::atomic<std::uint64_t> lock_wait_ns{0};
+            type_entry* next = nullptr;
+        };
+
+        struct type_registry {
+            std::mutex mutex;
+            type_entry* head = nullptr;
+        };
+
+        auto inline get_type_registry() -> type_registry&
+        {
+            static type_registry* r = new type_registry;
+            return *r;
+        }
+
+        auto inline register_type(const char* type_name, std::size_t size) -> type_entry*
+        {
+            type_entry* entry = new type_entry;
+            entry->type_name = type_name;
+            entry->size = size;
+            type_registry& r = get_type_registry();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            entry->next = r.head;
+            r.head = entry;
+            return entry;
+        }
+
+        // Registered once per T, on the first Lifetime<T>
+        template<class T>
+        auto type_entry_for() -> type_entry*
+        {
+            static type_entry* const entry = register_type(lifetime_detail::type_name<T>(), sizeof(std::remove_extent_t<typename lifetime_detail::value_report<T>::type>));
+            return entry;
+        }
+    }
+
+    // Counters of every instantiated T, most live bytes first
+    auto inline by_type() -> std::vector<type_counters>
+    {
+        detail::type_registry& r = detail::get_type_registry();
+        std::vector<type_counters> out;
+        {
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            for(const detail::type_entry* entry = r.head; entry != nullptr; entry = entry->next)
+            {
+                type_counters c;
+                c.type_name = entry->type_name;
+                c.size = entry->size;
+                c.created = entry->created.load(std::memory_order_relaxed);
+                c.destroyed = entry->destroyed.load(std::memory_order_relaxed);
+                c.live = c.created >= c.destroyed ? c.created - c.destroyed : 0U;
+                c.live_bytes = entry->live_bytes.load(std::memory_order_relaxed);
+                c.shared_borrows = entry->shared_borrows.load(std::memory_order_relaxed);
+                c.mutable_borrows = entry->mutable_borrows.load(std::memory_order_relaxed);
+                c.lock_samples = entry->lock_samples.load(std::memory_order_relaxed);
+                c.lock_wait_ns = entry->lock_wait_ns.load(std::memory_order_relaxed);
+                out.push_back(c);
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const type_counters& a, const type_counters& b) { return a.live_bytes > b.live_bytes; });
+        return out;
+    }
+#endif
+}
+#endif
+
+#if defined(LIFETIME_HEAP_PROFILE)
+// Live Lifetime memory by creation site (define LIFETIME_HEAP_PROFILE to enable)
+// Every from() call site (per T) gets one set of counters; the value and the Lifetime's own
+// cells are both charged to it, so many small objects still show up under their real owner.
+namespace lifetime_heap {
+
+    struct site_usage {
+        lifetime_site site;
+        const char* type_name = nullptr;
+        // Bytes per object: the value (averaged over the live ones, which differ for T[]), and the
+        // owner/mutator/mutex/refs/info cells around it
+        std::size_t value_size = 0U;
+        std::size_t cell_size = 0U;
+        std::uint64_t created = 0;
+        std::uint64_t live = 0;
+        std::uint64_t peak_live = 0;
+        std::uint64_t live_bytes = 0;
+    };
+
+    namespace detail {
+
+        struct site_entry {
+            lifetime_site site;
+            const char* type_name = nullptr;
+            std::size_t value_size = 0U;
+            std::size_t cell_size = 0U;
+            std::atomic<std::uint64_t> created{0};
+            std::atomic<std::uint64_t> destroyed{0};
+            std::atomic<std::uint64_t> peak_live{0};
+            // Value bytes of the live objects
+            std::atomic<std::uint64_t> value_bytes{0};
+        };
+
+        // Source locations of one site compare equal even when the file name literal is
+        // duplicated across translation units
+        struct site_key {
+            const char* file;
+            std::uint_least32_t line;
+            std::uint_least32_t column;
+            const char* type_name;
+
+            auto operator<(const site_key& other) const noexcept -> bool
+            {
+                if(this->line != other.line) return this->line < other.line;
+                if(this->column != other.column) return this->column < other.column;
+                // By content: one type's name can sit at different addresses across translation units
+                if(int c = std::strcmp(this->type_name, other.type_name)) return c < 0;
+                return std::strcmp(this->file, other.file) < 0;
+            }
+        };
+
+        struct site_registry {
+            std::mutex mutex;
+            std::map<site_key, site_entry*> sites;
+        };
+
+        auto inline get_site_registry() -> site_registry&
+        {
+            static site_registry* r = new site_registry;
+            return *r;
+        }
+
+        // Entries are never freed, so objects can outlive a report (or the registry)
+        auto inline entry_for(const lifetime_site& site, const char* type_name, std::size_t value_size, std::size_t cell_size) -> site_entry*
+        {
+            const site_key key{site.location.file_name(), site.location.line(), site.location.column(), type_name};
+            site_registry& r = get_site_registry();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            site_entry*& entry = r.sites[key];
+            if(entry == nullptr)
+            {
+                entry = new site_entry;
+                entry->site = site;
+                entry->type_name = type_name;
+                entry->value_size = value_size;
+                entry->cell_size = cell_size;
+            }
+            return entry;
+        }
+
+        auto inline on_create(site_entry* entry, std::size_t value_size) noexcept -> void
+        {
+            entry->value_bytes.fetch_add(value_size, std::memory_order_relaxed);
+            const std::uint64_t created = entry->created.fetch_add(1U, std::memory_order_relaxed) + 1U;
+            const std::uint64_t live = created - std::min(created, entry->destroyed.load(std::memory_order_relaxed));
+            std::uint64_t peak = entry->peak_live.load(std::memory_order_relaxed);
+            while(live > peak && !entry->peak_live.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+        }
+
+        auto inline on_destroy(site_entry* entry, std::size_t value_size) noexcept -> void
+        {
+            entry->value_bytes.fetch_sub(value_size, std::memory_order_relaxed);
+            entry->destroyed.fetch_add(1U, std::memory_order_relaxed);
+        }
+    }
+
+    // Creation sites with the most live bytes, largest first (all of them if count is 0)
+    auto inline top_sites(std::size_t count = 0U) -> std::vector<site_usage>
+    {
+        detail::site_registry& r = detail::get_site_registry();
+        std::vector<site_usage> out;
+        {
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            for(const auto& [key, entry] : r.sites)
+            {
+                site_usage u;
+                u.site = entry->site;
+                u.type_name = entry->type_name;
+                u.cell_size = entry->cell_size;
+                u.created = entry->created.load(std::memory_order_relaxed);
+                const std::uint64_t destroyed = entry->destroyed.load(std::memory_order_relaxed);
+                u.live = u.created >= destroyed ? u.created - destroyed : 0U;
+                u.peak_live = entry->peak_live.load(std::memory_order_relaxed);
+                const std::uint64_t value_bytes = entry->value_bytes.load(std::memory_order_relaxed);
+                u.value_size = u.live != 0U ? static_cast<std::size_t>(value_bytes / u.live) : entry->value_size;
+                u.live_bytes = value_bytes + u.live * u.cell_size;
+                out.push_back(u);
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const site_usage& a, const site_usage& b) { return a.live_bytes > b.live_bytes; });
+        if(count != 0U && out.size() > count) out.resize(count);
+        return out;
+    }
+
+    // Human readable report of top_sites()
+    auto inline report(std::size_t count = 10U) -> std::string
+    {
+        std::stringstream ss;
+        std::uint64_t total = 0;
+        const auto sites = top_sites();
+        for(const auto& u : sites)
+            total += u.live_bytes;
+        ss << "Lifetime heap profile: " << total << " live bytes at " << sites.size() << " creation sites\n";
+        for(std::size_t i = 0; i < sites.size() && i < count; ++i)
+        {
+            const auto& u = sites[i];
+            ss << u.live_bytes << " bytes \t" << u.live << " live (peak " << u.peak_live << ", " << u.created << " created) <"
+               << u.type_name << "> " << u.value_size << " + " << u.cell_size << " bytes each\n"
+               << "    " << u.site.location.file_name() << ":" << u.site.location.line() << ":" << u.site.location.column()
+               << " in " << u.site.location.function_name() << "\n";
+        }
+        return ss.str();
+    }
+}
+#endif
+
+#if defined(LIFETIME_REGISTRY)
+namespace lifetime_debug {
+
+    // One handle of a live Lifetime
+    struct handle_state {
+        const void* handle = nullptr;
+        bool is_owner = false;
+        bool is_mutator = false;
+        lifetime_site site;
+    };
+
+    // A live Lifetime as seen by the registry
+    struct object_state {
+        const void* id = nullptr;
+        const char* type_name = nullptr;
+        lifetime_site created_at;
+        bool owned = false;
+        bool mutably_borrowed = false;
+        std::size_t handle_count = 0U;
+        // Only filled for Lifetimes tracked by identity
+        bool tracked = false;
+        std::vector<handle_state> handles;
+    };
+}
+#endif
+
+namespace lifetime_detail {
+
+#if defined(LIFETIME_PROFILE_LOCKS) || defined(LIFETIME_STAMP_BORROWS) || defined(LIFETIME_RECORD) || defined(LIFETIME_OP_TIMERS)
+    auto inline now_ns() noexcept -> std::uint64_t
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+#endif
+
+#if defined(LIFETIME_STAMP_BORROWS) || defined(LIFETIME_RECORD)
+    // Small sequential id of the calling thread
+    auto inline thread_index() noexcept -> std::uint32_t
+    {
+        static std::atomic<std::uint32_t> next{1};
+        thread_local const std::uint32_t index = next.fetch_add(1U, std::memory_order_relaxed);
+        return index;
+    }
+#endif
+
+    // Id of one handle in a recording (empty without LIFETIME_RECORD; 0 when not recorded)
+    struct record_id {
+#if defined(LIFETIME_RECORD)
+        std::uint32_t value = 0;
+#endif
+    };
+
+#if defined(LIFETIME_STAMP_BORROWS)
+    struct borrow_stamp {
+        std::uint64_t acquired = 0;
+        std::uint32_t thread = 0;
+        bool is_mutable = false;
+#if defined(LIFETIME_TRACK_BORROWS)
+        // Linked into the outstanding borrows while held (guarded by the detector mutex)
+        borrow_stamp* held_prev = nullptr;
+        borrow_stamp* held_next = nullptr;
+        const void* id = nullptr;
+        const char* type_name = nullptr;
+        const lifetime_site* site = nullptr;
+#endif
+    };
+#endif
+
+#if defined(LIFETIME_PROFILE_LOCKS)
+    // Sampled lock timings of one Lifetime
+    struct contention_record {
+        std::atomic<std::uint64_t> samples{0};
+        std::atomic<std::uint64_t> wait_ns{0};
+        std::atomic<std::uint64_t> max_wait_ns{0};
+        std::atomic<std::uint64_t> hold_ns{0};
+    };
+#endif
+
+    // Cold per-object data, shared by a Lifetime and all of its borrows
+    // (only allocated when LIFETIME_CONTROL_INFO is defined)
+    struct control_info {
+#if defined(LIFETIME_CONTROL_INFO)
+        // The object's id in every report, trace and probe: the address of its shared refs
+        const void* id = nullptr;
+        const char* type_name = nullptr;
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        lifetime_stats::detail::type_entry* type = nullptr;
+#endif
+#if defined(LIFETIME_HEAP_PROFILE)
+        lifetime_heap::detail::site_entry* site = nullptr;
+#endif
+#if defined(LIFETIME_TYPE_STATS) || defined(LIFETIME_HEAP_PROFILE)
+        // Bytes of the value, as charged to its type and creation site
+        std::size_t value_size = 0U;
+#endif
+#if defined(LIFETIME_RECORD)
+        // Object id in the recording (0 if created while the recorder was off)
+        std::uint32_t record_object = 0;
+#endif
+#if defined(LIFETIME_SOURCE_LOCATION)
+        lifetime_site created_at;
+#endif
+#if defined(LIFETIME_PROFILE_LOCKS)
+        contention_record contention;
+        // Intrusive list of profiled objects (guarded by the profiler mutex)
+        control_info* profiled_prev = nullptr;
+        control_info* profiled_next = nullptr;
+        std::atomic<bool> profiled{false};
+#endif
+#if defined(LIFETIME_REGISTRY)
+        // Intrusive list of live objects (guarded by the registry mutex)
+        control_info* live_prev = nullptr;
+        control_info* live_next = nullptr;
+        // The object's shared cells, read back by inspect()
+        const void* owner = nullptr;
+        const void* mutator = nullptr;
+        const void* refs = nullptr;
+        void (*inspect)(const control_info&, lifetime_debug::object_state&) = nullptr;
+#endif
+    };
+
+#if defined(LIFETIME_CONTROL_INFO)
+    using info_ptr = control_info*;
+#else
+    // Always null without LIFETIME_CONTROL_INFO, so handles store nothing
+    struct info_ptr {
+        constexpr info_ptr() noexcept = default;
+        constexpr info_ptr(control_info*) noexcept {}
+
+        constexpr operator control_info*() const noexcept
+        {
+            return nullptr;
+        }
+    };
+#endif
+
+    template<class T>
+    auto make_info([[maybe_unused]] const T& value, [[maybe_unused]] const void* id, [[maybe_unused]] const lifetime_site& site) -> control_info*
+    {
+#if defined(LIFETIME_CONTROL_INFO)
+        control_info* info = new control_info;
+        info->id = id;
+        info->type_name = type_name<T>();
+#if defined(LIFETIME_TYPE_STATS) || defined(LIFETIME_HEAP_PROFILE)
+        info->value_size = value_report<T>::size(value);
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        info->type = lifetime_stats::detail::type_entry_for<T>();
+#endif
+#if defined(LIFETIME_SOURCE_LOCATION)
+        info->created_at = site;
+#endif
+        return info;
+#else
+        return nullptr;
+#endif
+    }
+}
+
+#if defined(LIFETIME_PROFILE_LOCKS)
+// Lock contention profiler (define LIFETIME_PROFILE_LOCKS to enable)
+// 1 in sample_rate() lock acquisitions per thread is timed; wait and hold times are
+// accumulated on the Lifetime that owns the mutex.
+namespace lifetime_profile {
+
+    struct contention_report {
+        const void* id = nullptr;
+        const char* type_name = nullptr;
+        lifetime_site created_at;
+        std::uint64_t samples = 0;
+        std::uint64_t wait_ns = 0;
+        std::uint64_t max_wait_ns = 0;
+        std::uint64_t hold_ns = 0;
+    };
+
+    namespace detail {
+
+        // Power-of-two buckets from 1us (2^10 ns) to ~1s (2^30 ns), plus overflow
+        inline constexpr unsigned histogram_buckets = 22U;
+
+        struct histogram {
+            std::atomic<std::uint64_t> buckets[histogram_buckets] = {};
+            std::atomic<std::uint64_t> count{0};
+            std::atomic<std::uint64_t> sum_ns{0};
+
+            auto record(std::uint64_t ns) noexcept -> void
+            {
+                unsigned bucket = 0U;
+                while(bucket < histogram_buckets - 1U && ns > (std::uint64_t{1} << (bucket + 10U))) ++bucket;
+                this->buckets[bucket].fetch_add(1U, std::memory_order_relaxed);
+                this->count.fetch_add(1U, std::memory_order_relaxed);
+                this->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+            }
+        };
+
+        struct profiler {
+            std::mutex mutex;
+            lifetime_detail::control_info* head = nullptr;
+            std::atomic<std::uint32_t> sample_rate{64};
+            // Totals of profiled Lifetimes that were already freed
+            contention_report retired;
+            // Sampled waits and holds of every Lifetime
+            histogram wait;
+            histogram hold;
+        };
+
+        auto inline get_profiler() -> profiler&
+        {
+            static profiler* p = new profiler;
+            return *p;
+        }
+
+        // Per-thread 1-in-N sampling decision
+        auto inline should_sample() noexcept -> bool
+        {
+            thread_local std::uint32_t tick = 0;
+            const std::uint32_t rate = get_profiler().sample_rate.load(std::memory_order_relaxed);
+            if(rate == 0U) return false;
+            if(++tick < rate) return false;
+            tick = 0;
+            return true;
+        }
+
+        auto inline link(lifetime_detail::control_info* info) -> void
+        {
+            profiler& p = get_profiler();
+            std::scoped_lock<std::mutex> lock(p.mutex);
+            if(info->profiled.load(std::memory_order_relaxed)) return;
+            info->profiled.store(true, std::memory_order_relaxed);
+            info->profiled_next = p.head;
+            if(p.head != nullptr) p.head->profiled_prev = info;
+            p.head = info;
+        }
+
+        auto inline unlink(lifetime_detail::control_info* info) -> void
+        {
+            profiler& p = get_profiler();
+            std::scoped_lock<std::mutex> lock(p.mutex);
+            if(!info->profiled.load(std::memory_order_relaxed)) return;
+            if(info->profiled_prev != nullptr) info->profiled_prev->profiled_next = info->profiled_next;
+            else p.head = info->profiled_next;
+            if(info->profiled_next != nullptr) info->profiled_next->profiled_prev = info->profiled_prev;
+            info->profiled.store(false, std::memory_order_relaxed);
+
+            const lifetime_detail::contention_record& c = info->contention;
+            p.retired.samples += c.samples.load(std::memory_order_relaxed);
+            p.retired.wait_ns += c.wait_ns.load(std::memory_order_relaxed);
+            p.retired.max_wait_ns = std::max(p.retired.max_wait_ns, c.max_wait_ns.load(std::memory_order_relaxed));
+            p.retired.hold_ns += c.hold_ns.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Time 1 in every `rate` acquisitions per thread (0 disables sampling)
+    auto inline set_sample_rate(std::uint32_t rate) noexcept -> void
+    {
+        detail::get_profiler().sample_rate.store(rate, std::memory_order_relaxed);
+    }
+
+    auto inline sample_rate() noexcept -> std::uint32_t
+    {
+        return detail::get_profiler().sample_rate.load(std::memory_order_relaxed);
+    }
+
+    // Live Lifetimes with the most sampled wait time, most contended first
+    auto inline top_contended(std::size_t count) -> std::vector<contention_report>
+    {
+        detail::profiler& p = detail::get_profiler();
+        std::vector<contention_report> out;
+        {
+            std::scoped_lock<std::mutex> lock(p.mutex);
+            for(const lifetime_detail::control_info* info = p.head; info != nullptr; info = info->profiled_next)
+            {
+                contention_report r;
+                r.id = info->id;
+                r.type_name = info->type_name;
+#if defined(LIFETIME_SOURCE_LOCATION)
+                r.created_at = info->created_at;
+#endif
+                r.samples = info->contention.samples.load(std::memory_order_relaxed);
+                r.wait_ns = info->contention.wait_ns.load(std::memory_order_relaxed);
+                r.max_wait_ns = info->contention.max_wait_ns.load(std::memory_order_relaxed);
+                r.hold_ns = info->contention.hold_ns.load(std::memory_order_relaxed);
+                out.push_back(r);
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const contention_report& a, const contention_report& b) { return a.wait_ns > b.wait_ns; });
+        if(out.size() > count) out.resize(count);
+        return out;
+    }
+
+    // Sampled totals of Lifetimes that were already freed
+    auto inline retired() -> contention_report
+    {
+        detail::profiler& p = detail::get_profiler();
+        std::scoped_lock<std::mutex> lock(p.mutex);
+        return p.retired;
+    }
+
+    // Human readable report of top_contended()
+    auto inline report(std::size_t count = 10U) -> std::string
+    {
+        std::stringstream ss;
+        ss << "Lifetime lock contention (1 in " << sample_rate() << " acquisitions sampled)\n";
+        for(const auto& r : top_contended(count))
+        {
+            ss << "Lifetime " << r.id << " <" << r.type_name << ">: \t"
+               << r.samples << " samples, wait " << r.wait_ns << " ns (max " << r.max_wait_ns << " ns), hold " << r.hold_ns << " ns\n";
+            ss << r.created_at.to_string();
+        }
+        return ss.str();
+    }
+}
+#endif
+
+#if defined(LIFETIME_TRACK_BORROWS)
+// Long-held borrow detector (define LIFETIME_TRACK_BORROWS to enable)
+// Every borrow() / borrow_mutable() handle is stamped when created; handles released
+// after more than threshold() are flagged, and outstanding() lists those still held.
+namespace lifetime_long_borrows {
+
+    struct long_borrow {
+        const void* id = nullptr;
+        const char* type_name = nullptr;
+        bool is_mutable = false;
+        std::uint64_t held_ns = 0;
+        lifetime_site site;
+    };
+
+    using handler_t = void(*)(const long_borrow&);
+
+    namespace detail {
+
+        constexpr std::size_t recent_capacity = 64U;
+
+        struct detector {
+            std::atomic<std::uint64_t> threshold_ns{10'000'000U};
+            std::atomic<handler_t> handler{nullptr};
+            std::atomic<std::uint64_t> flagged{0};
+            std::mutex mutex;
+            long_borrow recent[recent_capacity];
+            std::size_t next = 0;
+            // Borrows currently held
+            lifetime_detail::borrow_stamp* held = nullptr;
+        };
+
+        auto inline get_detector() -> detector&
+        {
+            static detector* d = new detector;
+            return *d;
+        }
+
+        auto inline flag(const long_borrow& borrow) -> void
+        {
+            detector& d = get_detector();
+            d.flagged.fetch_add(1U, std::memory_order_relaxed);
+            {
+                std::scoped_lock<std::mutex> lock(d.mutex);
+                d.recent[d.next % recent_capacity] = borrow;
+                ++d.next;
+            }
+            if(handler_t handler = d.handler.load(std::memory_order_acquire)) handler(borrow);
+        }
+
+        auto inline hold(lifetime_detail::borrow_stamp& stamp) -> void
+        {
+            detector& d = get_detector();
+            std::scoped_lock<std::mutex> lock(d.mutex);
+            stamp.held_next = d.held;
+            if(d.held != nullptr) d.held->held_prev = &stamp;
+            d.held = &stamp;
+        }
+
+        auto inline unhold(lifetime_detail::borrow_stamp& stamp) -> void
+        {
+            detector& d = get_detector();
+            std::scoped_lock<std::mutex> lock(d.mutex);
+            if(stamp.held_prev != nullptr) stamp.held_prev->held_next = stamp.held_next;
+            else d.held = stamp.held_next;
+            if(stamp.held_next != nullptr) stamp.held_next->held_prev = stamp.held_prev;
+            stamp.held_prev = nullptr;
+            stamp.held_next = nullptr;
+        }
+    }
+
+    // Flag borrows held for longer than this (default 10ms)
+    auto inline set_threshold(std::chrono::nanoseconds threshold) noexcept -> void
+    {
+        detail::get_detector().threshold_ns.store(static_cast<std::uint64_t>(threshold.count()), std::memory_order_relaxed);
+    }
+
+    auto inline threshold() noexcept -> std::chrono::nanoseconds
+    {
+        return std::chrono::nanoseconds(detail::get_detector().threshold_ns.load(std::memory_order_relaxed));
+    }
+
+    // Called on the releasing thread for every flagged borrow (nullptr to clear)
+    auto inline set_handler(handler_t handler) noexcept -> void
+    {
+        detail::get_detector().handler.store(handler, std::memory_order_release);
+    }
+
+    // Number of borrows flagged so far
+    auto inline flagged() noexcept -> std::uint64_t
+    {
+        return detail::get_detector().flagged.load(std::memory_order_relaxed);
+    }
+
+    // The most recently flagged borrows, oldest first
+    auto inline recent() -> std::vector<long_borrow>
+    {
+        detail::detector& d = detail::get_detector();
+        std::scoped_lock<std::mutex> lock(d.mutex);
+        const std::size_t count = std::min(d.next, detail::recent_capacity);
+        std::vector<long_borrow> out;
+        for(std::size_t i = d.next - count; i < d.next; ++i)
+            out.push_back(d.recent[i % detail::recent_capacity]);
+        return out;
+    }
+
+    // Borrows still held after more than threshold(), with their age so far (held_ns), oldest
+    // first. Poll it (e.g. from a watchdog thread) to catch a borrow that is never released.
+    auto inline outstanding() -> std::vector<long_borrow>
+    {
+        detail::detector& d = detail::get_detector();
+        const std::uint64_t limit = d.threshold_ns.load(std::memory_order_relaxed);
+        std::vector<long_borrow> out;
+        {
+            std::scoped_lock<std::mutex> lock(d.mutex);
+            const std::uint64_t now = lifetime_detail::now_ns();
+            for(const lifetime_detail::borrow_stamp* stamp = d.held; stamp != nullptr; stamp = stamp->held_next)
+            {
+                const std::uint64_t held = now > stamp->acquired ? now - stamp->acquired : 0U;
+                if(held <= limit) continue;
+                long_borrow borrow;
+                borrow.id = stamp->id;
+                borrow.type_name = stamp->type_name;
+                borrow.is_mutable = stamp->is_mutable;
+                borrow.held_ns = held;
+                borrow.site = *stamp->site;
+                out.push_back(borrow);
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const long_borrow& a, const long_borrow& b) { return a.held_ns > b.held_ns; });
+        return out;
+    }
+
+    // Human readable report of outstanding() and recent()
+    auto inline report() -> std::string
+    {
+        std::stringstream ss;
+        ss << "Long-held Lifetime borrows (threshold " << threshold().count() << " ns, " << flagged() << " flagged)\n";
+        for(const auto& b : outstanding())
+        {
+            ss << (b.is_mutable ? "Mutable" : "Shared") << " borrow of Lifetime " << b.id << " <" << b.type_name << ">: \t"
+               << "still held after " << b.held_ns << " ns\n";
+            ss << b.site.to_string();
+        }
+        for(const auto& b : recent())
+        {
+            ss << (b.is_mutable ? "Mutable" : "Shared") << " borrow of Lifetime " << b.id << " <" << b.type_name << ">: \t"
+               << "held " << b.held_ns << " ns\n";
+            ss << b.site.to_string();
+        }
+        return ss.str();
+    }
+}
+#endif
+
+#if defined(LIFETIME_TRACE)
+// Borrow span tracer (define LIFETIME_TRACE to enable)
+// While started, every released borrow is recorded as a duration span on the thread that
+// took it; write() emits Chrome trace-event JSON (chrome://tracing, Perfetto).
+namespace lifetime_trace {
+
+    struct span {
+        const void* id = nullptr;
+        const char* type_name = nullptr;
+        bool is_mutable = false;
+        std::uint32_t thread = 0;
+        std::uint64_t begin_ns = 0;
+        std::uint64_t end_ns = 0;
+        lifetime_site site;
+    };
+
+    namespace detail {
+
+        struct thread_buffer {
+            std::mutex mutex;
+            std::vector<span> spans;
+
+            auto add_to(std::vector<span>& out) -> void
+            {
+                std::scoped_lock<std::mutex> lock(this->mutex);
+                out.insert(out.end(), this->spans.begin(), this->spans.end());
+            }
+        };
+
+        // Spans of live threads, plus those of threads that already exited
+        struct tracer : lifetime_detail::thread_registry<thread_buffer, std::vector<span>> {
+            std::atomic<bool> enabled{false};
+        };
+
+        auto inline get_tracer() -> tracer&
+        {
+            static tracer* t = new tracer;
+            return *t;
+        }
+
+        auto LIFETIME_OUT_OF_LINE record(const span& s) -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+        {
+            thread_buffer& buffer = lifetime_detail::thread_data<&get_tracer>();
+            std::scoped_lock<std::mutex> lock(buffer.mutex);
+            buffer.spans.push_back(s);
+        }
+#else
+        ;
+#endif
+
+        auto inline write_json_string(std::ostream& out, const char* str) -> void
+        {
+            out << '"';
+            for(; str != nullptr && *str != '\0'; ++str)
+            {
+                const char c = *str;
+                if(c == '"' || c == '\\') out << '\\' << c;
+                else if(static_cast<unsigned char>(c) < 0x20U) out << ' ';
+                else out << c;
+            }
+            out << '"';
+        }
+
+        auto inline write_span(std::ostream& out, const span& s) -> void
+        {
+            std::stringstream id;
+            id << s.id;
+            out << "{\"name\":";
+            write_json_string(out, s.is_mutable ? "borrow_mutable" : "borrow");
+            out << ",\"cat\":\"lifetime\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread
+                << ",\"ts\":" << (s.begin_ns / 1000U) << '.' << (s.begin_ns % 1000U / 100U) << (s.begin_ns % 100U / 10U) << (s.begin_ns % 10U)
+                << ",\"dur\":" << ((s.end_ns - s.begin_ns) / 1000U) << '.' << ((s.end_ns - s.begin_ns) % 1000U / 100U) << ((s.end_ns - s.begin_ns) % 100U / 10U) << ((s.end_ns - s.begin_ns) % 10U)
+                << ",\"args\":{\"id\":";
+            write_json_string(out, id.str().c_str());
+            out << ",\"type\":";
+            write_json_string(out, s.type_name);
+#if defined(LIFETIME_SOURCE_LOCATION)
+            out << ",\"file\":";
+            write_json_string(out, s.site.location.file_name());
+            out << ",\"line\":" << s.site.location.line();
+#endif
+            out << "}}";
+        }
+    }
+
+    // Start / stop recording spans (recorded spans are kept until clear())
+    auto inline start() noexcept -> void
+    {
+        detail::get_tracer().enabled.store(true, std::memory_order_relaxed);
+    }
+
+    auto inline stop() noexcept -> void
+    {
+        detail::get_tracer().enabled.store(false, std::memory_order_relaxed);
+    }
+
+    auto inline is_enabled() noexcept -> bool
+    {
+        return detail::get_tracer().enabled.load(std::memory_order_relaxed);
+    }
+
+    // Drop every recorded span
+    auto inline clear() -> void
+    {
+        detail::tracer& t = detail::get_tracer();
+        std::scoped_lock<std::mutex> lock(t.mutex);
+        t.retired.clear();
+        for(auto* buffer : t.threads)
+        {
+            std::scoped_lock<std::mutex> buffer_lock(buffer->mutex);
+            buffer->spans.clear();
+        }
+    }
+
+    // Write every recorded span as Chrome trace-event JSON
+    auto inline write(std::ostream& out) -> void
+    {
+        detail::tracer& t = detail::get_tracer();
+        std::scoped_lock<std::mutex> lock(t.mutex);
+        bool first = true;
+        out << "{\"traceEvents\":[";
+        for(const auto& s : t.retired)
+        {
+            out << (first ? "\n" : ",\n");
+            detail::write_span(out, s);
+            first = false;
+        }
+        for(auto* buffer : t.threads)
+        {
+            std::scoped_lock<std::mutex> buffer_lock(buffer->mutex);
+            for(const auto& s : buffer->spans)
+            {
+                out << (first ? "\n" : ",\n");
+                detail::write_span(out, s);
+                first = false;
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+    auto inline write(const std::string& path) -> bool
+    {
+        std::ofstream file(path);
+        if(!file) return false;
+        write(file);
+        return static_cast<bool>(file);
+    }
+}
+#endif
+
+#if defined(LIFETIME_RECORD)
+// Operation recorder (define LIFETIME_RECORD to enable)
+// Between start() and stop(), every operation on a Lifetime created while recording is
+// logged per thread; write() stores the merged stream in a compact binary file, and
+// replayer<T> re-executes it (see the end of this file).
+namespace lifetime_record {
+
+    // One logged operation; objects and handles are numbered from 1 in creation order
+    struct event {
+        std::uint64_t time_ns = 0;
+        std::uint32_t object = 0;
+        std::uint32_t handle = 0;
+        // create: value bytes; borrow / borrow_mutable: handle count; move_to: handle giving up
+        // ownership; violation: lifetime_violation
+        std::uint32_t aux = 0;
+        std::uint16_t thread = 0;
+        lifetime_op op = lifetime_op::count;
+        std::uint8_t reserved = 0;
+    };
+
+    static_assert(sizeof(event) == 24U, "lifetime_record::event is written to disk as is");
+
+    // File layout: header, then header.count events in native byte order
+    struct file_header {
+        char magic[8] = {'L', 'T', 'R', 'E', 'C', 'O', 'R', 'D'};
+        std::uint32_t version = 1;
+        std::uint32_t event_size = sizeof(event);
+        std::uint64_t count = 0;
+    };
+
+    namespace detail {
+
+        struct thread_buffer {
+            std::mutex mutex;
+            std::vector<event> events;
+
+            auto add_to(std::vector<event>& out) -> void
+            {
+                std::scoped_lock<std::mutex> lock(this->mutex);
+                out.insert(out.end(), this->events.begin(), this->events.end());
+            }
+        };
+
+        // Events of live threads, plus those of threads that already exited
+        struct recorder : lifetime_detail::thread_registry<thread_buffer, std::vector<event>> {
+            std::atomic<bool> enabled{false};
+            std::atomic<std::uint32_t> next_object{1};
+            std::atomic<std::uint32_t> next_handle{1};
+            std::atomic<std::uint64_t> dropped{0};
+        };
+
+        auto inline get_recorder() -> recorder&
+        {
+            static recorder* r = new recorder;
+            return *r;
+        }
+
+        // Called from noexcept paths, so an event that cannot be stored is only counted
+        auto LIFETIME_OUT_OF_LINE log(lifetime_op op, std::uint32_t object, std::uint32_t handle, std::uint32_t aux) noexcept -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+        {
+            event e;
+            e.time_ns = lifetime_detail::now_ns();
+            e.object = object;
+            e.handle = handle;
+            e.aux = aux;
+            e.thread = static_cast<std::uint16_t>(lifetime_detail::thread_index());
+            e.op = op;
+#if defined(LIFETIME_EXCEPTIONS)
+            try
+            {
+#endif
+                thread_buffer& buffer = lifetime_detail::thread_data<&get_recorder>();
+                std::scoped_lock<std::mutex> lock(buffer.mutex);
+                buffer.events.push_back(e);
+#if defined(LIFETIME_EXCEPTIONS)
+            }
+            catch(...)
+            {
+                get_recorder().dropped.fetch_add(1U, std::memory_order_relaxed);
+            }
+#endif
+        }
+#else
+        ;
+#endif
+    }
+
+    // Start / stop recording (recorded events are kept until clear())
+    // Only Lifetimes created while recording are logged, so start before the workload.
+    auto inline start() noexcept -> void
+    {
+        detail::get_recorder().enabled.store(true, std::memory_order_relaxed);
+    }
+
+    auto inline stop() noexcept -> void
+    {
+        detail::get_recorder().enabled.store(false, std::memory_order_relaxed);
+    }
+
+    auto inline is_enabled() noexcept -> bool
+    {
+        return detail::get_recorder().enabled.load(std::memory_order_relaxed);
+    }
+
+    // Events lost to allocation failures
+    auto inline dropped() noexcept -> std::uint64_t
+    {
+        return detail::get_recorder().dropped.load(std::memory_order_relaxed);
+    }
+
+    // Drop every recorded event
+    auto inline clear() -> void
+    {
+        detail::recorder& r = detail::get_recorder();
+        std::scoped_lock<std::mutex> lock(r.mutex);
+        r.retired.clear();
+        for(auto* buffer : r.threads)
+        {
+            std::scoped_lock<std::mutex> buffer_lock(buffer->mutex);
+            buffer->events.clear();
+        }
+    }
+
+    // Every recorded event, merged across threads in time order
+    auto inline events() -> std::vector<event>
+    {
+        detail::recorder& r = detail::get_recorder();
+        std::vector<event> out;
+        {
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            out = r.retired;
+            for(auto* buffer : r.threads)
+            {
+                std::scoped_lock<std::mutex> buffer_lock(buffer->mutex);
+                out.insert(out.end(), buffer->events.begin(), buffer->events.end());
+            }
+        }
+        std::stable_sort(out.begin(), out.end(), [](const event& a, const event& b) { return a.time_ns < b.time_ns; });
+        return out;
+    }
+
+    auto inline write(std::ostream& out, const std::vector<event>& stream) -> void
+    {
+        file_header header;
+        header.count = stream.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(stream.data()), static_cast<std::streamsize>(stream.size() * sizeof(event)));
+    }
+
+    auto inline write(std::ostream& out) -> void
+    {
+        write(out, events());
+    }
+
+    auto inline write(const std::string& path) -> bool
+    {
+        std::ofstream file(path, std::ios::binary);
+        if(!file) return false;
+        write(file);
+        return static_cast<bool>(file);
+    }
+
+    // Read a stream written by write() (false if it is not a recording or is truncated)
+    auto inline read(std::istream& in, std::vector<event>& out) -> bool
+    {
+        file_header header;
+        file_header expected;
+        if(!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        if(std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) return false;
+        if(header.version != expected.version || header.event_size != expected.event_size) return false;
+        // header.count comes from the file: grow in bounded chunks as events actually arrive, so a
+        // corrupt count fails on the short read instead of allocating it up front
+        constexpr std::uint64_t chunk = 4096U;
+        out.clear();
+        for(std::uint64_t left = header.count; left != 0U;)
+        {
+            const std::size_t count = static_cast<std::size_t>(left < chunk ? left : chunk);
+            const std::size_t at = out.size();
+            out.resize(at + count);
+            if(!in.read(reinterpret_cast<char*>(out.data() + at), static_cast<std::streamsize>(count * sizeof(event))))
+            {
+                out.clear();
+                return false;
+            }
+            left -= count;
+        }
+        return true;
+    }
+
+    auto inline read(const std::string& path, std::vector<event>& out) -> bool
+    {
+        std::ifstream file(path, std::ios::binary);
+        if(!file) return false;
+        return read(file, out);
+    }
+}
+#endif
+
+#if defined(LIFETIME_OP_TIMERS)
+// Hot-path timers (define LIFETIME_OP_TIMERS to enable)
+// borrow, borrow_mutable, get_mutable, set and handle destruction (release) are bracketed
+// with TSC (or steady clock) stamps; only Lifetime's own work is timed, not what the caller
+// does under the borrow nor set()'s assignment. Each thread fills its own log-linear
+// histograms (4 sub-buckets per power of two, in ticks); reads merge them.
+namespace lifetime_timers {
+
+    struct latency_summary {
+        lifetime_op op = lifetime_op::count;
+        std::uint64_t count = 0;
+        double mean_ns = 0.0;
+        // Upper bounds of the buckets holding each percentile
+        double p50_ns = 0.0;
+        double p90_ns = 0.0;
+        double p99_ns = 0.0;
+        double p999_ns = 0.0;
+        double max_ns = 0.0;
+    };
+
+    struct bucket {
+        double lower_ns = 0.0;
+        double upper_ns = 0.0;
+        std::uint64_t count = 0;
+    };
+
+    // Whether the timers read the TSC (otherwise the steady clock)
+    constexpr auto uses_tsc() noexcept -> bool
+    {
+#if defined(LIFETIME_OP_TIMERS_TSC)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    namespace detail {
+
+        inline constexpr unsigned sub_buckets = 4U;
+        inline constexpr unsigned bucket_count = 64U * sub_buckets;
+        inline constexpr unsigned op_count = static_cast<unsigned>(lifetime_op::count);
+
+        auto inline ticks() noexcept -> std::uint64_t
+        {
+#if defined(LIFETIME_OP_TIMERS_TSC)
+            return static_cast<std::uint64_t>(__rdtsc());
+#else
+            return lifetime_detail::now_ns();
+#endif
+        }
+
+        // v < 4 gets its own bucket; above that, 4 linear buckets per power of two
+        constexpr auto bucket_of(std::uint64_t value) noexcept -> unsigned
+        {
+            if(value < sub_buckets) return static_cast<unsigned>(value);
+            unsigned msb = 63U;
+            while((value >> msb) == 0U) --msb;
+            return (msb - 1U) * sub_buckets + static_cast<unsigned>((value >> (msb - 2U)) & (sub_buckets - 1U));
+        }
+
+        constexpr auto bucket_lower(unsigned index) noexcept -> std::uint64_t
+        {
+            if(index < sub_buckets) return index;
+            const unsigned msb = index / sub_buckets + 1U;
+            return static_cast<std::uint64_t>(sub_buckets + index % sub_buckets) << (msb - 2U);
+        }
+
+        // Merged histograms
+        struct histogram_totals {
+            std::uint64_t buckets[op_count][bucket_count] = {};
+            std::uint64_t ticks[op_count] = {};
+        };
+
+        struct thread_histograms {
+            std::atomic<std::uint64_t> buckets[op_count][bucket_count] = {};
+            std::atomic<std::uint64_t> ticks[op_count] = {};
+
+            auto add_to(histogram_totals& out) const noexcept -> void
+            {
+                for(unsigned op = 0; op < op_count; ++op)
+                {
+                    out.ticks[op] += this->ticks[op].load(std::memory_order_relaxed);
+                    for(unsigned i = 0; i < bucket_count; ++i)
+                        out.buckets[op][i] += this->buckets[op][i].load(std::memory_order_relaxed);
+                }
+            }
+        };
+
+        // Histograms of live threads, plus the totals of threads that already exited
+        struct registry : lifetime_detail::thread_registry<thread_histograms, histogram_totals> {
+            // First clock reading, for converting ticks to nanoseconds
+            std::uint64_t anchor_ticks = ticks();
+            std::uint64_t anchor_ns = lifetime_detail::now_ns();
+        };
+
+        auto inline get_registry() -> registry&
+        {
+            static registry* r = new registry;
+            return *r;
+        }
+
+        // Only the owning thread writes, so a relaxed load + store is enough
+        auto inline record(lifetime_op op, std::uint64_t elapsed) noexcept -> void
+        {
+            thread_histograms& histograms = lifetime_detail::thread_data<&get_registry>();
+            const unsigned index = static_cast<unsigned>(op);
+            std::atomic<std::uint64_t>& count = histograms.buckets[index][bucket_of(elapsed)];
+            count.store(count.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+            std::atomic<std::uint64_t>& total = histograms.ticks[index];
+            total.store(total.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+        }
+    }
+
+    // Nanoseconds per clock tick, measured against the steady clock since the first timed
+    // operation (waits up to 10ms the first time if that is too short to be accurate)
+    auto inline ns_per_tick() -> double
+    {
+#if defined(LIFETIME_OP_TIMERS_TSC)
+        const detail::registry& r = detail::get_registry();
+        std::uint64_t ns = lifetime_detail::now_ns();
+        while(ns - r.anchor_ns < 10000000U)
+            ns = lifetime_detail::now_ns();
+        const std::uint64_t ticks = detail::ticks();
+        return ticks > r.anchor_ticks ? static_cast<double>(ns - r.anchor_ns) / static_cast<double>(ticks - r.anchor_ticks) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+
+    // Non-empty buckets of one operation's histogram
+    auto inline buckets(lifetime_op op) -> std::vector<bucket>
+    {
+        detail::histogram_totals merged;
+        {
+            detail::registry& r = detail::get_registry();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            merged = r.retired;
+            for(const auto* thread : r.threads)
+                thread->add_to(merged);
+        }
+        const double scale = ns_per_tick();
+        std::vector<bucket> out;
+        for(unsigned b = 0; b < detail::bucket_count; ++b)
+        {
+            const std::uint64_t count = merged.buckets[static_cast<unsigned>(op)][b];
+            if(count == 0U) continue;
+            const std::uint64_t upper = b + 1U < detail::bucket_count ? detail::bucket_lower(b + 1U) : ~std::uint64_t{0};
+            out.push_back(bucket{static_cast<double>(detail::bucket_lower(b)) * scale, static_cast<double>(upper) * scale, count});
+        }
+        return out;
+    }
+
+    auto inline summary(lifetime_op op) -> latency_summary
+    {
+        latency_summary out;
+        out.op = op;
+        const std::vector<bucket> histogram = buckets(op);
+        double total = 0.0;
+        for(const auto& b : histogram)
+        {
+            out.count += b.count;
+            total += (b.lower_ns + b.upper_ns) / 2.0 * static_cast<double>(b.count);
+        }
+        if(out.count == 0U) return out;
+        out.mean_ns = total / static_cast<double>(out.count);
+        const auto percentile = [&](double fraction)
+        {
+            const std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(out.count - 1U)) + 1U;
+            std::uint64_t seen = 0;
+            for(const auto& b : histogram)
+                if((seen += b.count) >= rank) return b.upper_ns;
+            return histogram.back().upper_ns;
+        };
+        out.p50_ns = percentile(0.5);
+        out.p90_ns = percentile(0.9);
+        out.p99_ns = percentile(0.99);
+        out.p999_ns = percentile(0.999);
+        out.max_ns = histogram.back().upper_ns;
+        return out;
+    }
+
+    // Human readable summary of every timed operation
+    auto inline report() -> std::string
+    {
+        std::stringstream ss;
+        ss << "Lifetime hot-path latency (" << (uses_tsc() ? "TSC" : "steady clock") << ", ns, bucket upper bounds)\n";
+        for(const lifetime_op op : {lifetime_op::borrow, lifetime_op::borrow_mutable, lifetime_op::get_mutable, lifetime_op::set, lifetime_op::release})
+        {
+            const latency_summary s = summary(op);
+            ss << lifetime_op_name(op) << ": \t" << s.count << " ops";
+            if(s.count != 0U)
+                ss << ", mean " << s.mean_ns << ", p50 " << s.p50_ns << ", p90 " << s.p90_ns << ", p99 " << s.p99_ns
+                   << ", p99.9 " << s.p999_ns << ", max " << s.max_ns;
+            ss << "\n";
+        }
+        return ss.str();
+    }
+}
+#endif
+
+#if defined(LIFETIME_SAMPLED_CHECKS)
+// Sampled checking (define LIFETIME_SAMPLED_CHECKS to enable)
+// Only 1 in rate() new Lifetimes per thread get full validation: every handle is tracked by
+// identity and violations carry source locations and the conflicting holder. The rest only
+// count their handles, which keeps ownership and mutability checks but skips the per-borrow
+// bookkeeping.
+namespace lifetime_sampling {
+
+    namespace detail {
+
+        auto inline rate_cell() noexcept -> std::atomic<std::uint32_t>&
+        {
+            static std::atomic<std::uint32_t> rate{100};
+            return rate;
+        }
+    }
+
+    // Fully check 1 in every `rate` Lifetimes (1 checks all of them, 0 none)
+    auto inline set_rate(std::uint32_t rate) noexcept -> void
+    {
+        detail::rate_cell().store(rate, std::memory_order_relaxed);
+    }
+
+    auto inline rate() noexcept -> std::uint32_t
+    {
+        return detail::rate_cell().load(std::memory_order_relaxed);
+    }
+}
+#endif
+
+#if defined(LIFETIME_REGISTRY)
+// Registry of live Lifetimes (define LIFETIME_REGISTRY to enable)
+// Every live object is linked into a global list, so leaked Lifetimes and dangling borrows
+// can be listed on demand and, by default, at exit. Reading a Lifetime's state is not
+// synchronised with its handles, so dumps are best taken while the process is quiet.
+namespace lifetime_debug {
+
+    namespace detail {
+
+        auto inline write_at_exit() -> void;
+
+        struct registry {
+            std::mutex mutex;
+            lifetime_detail::control_info* head = nullptr;
+            std::size_t count = 0U;
+            std::atomic<bool> report_at_exit{true};
+
+            registry()
+            {
+                std::atexit(&write_at_exit);
+            }
+        };
+
+        auto inline get_registry() -> registry&
+        {
+            static registry* r = new registry;
+            return *r;
+        }
+
+        auto LIFETIME_OUT_OF_LINE link(lifetime_detail::control_info* info) -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+        {
+            registry& r = get_registry();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            info->live_next = r.head;
+            if(r.head != nullptr) r.head->live_prev = info;
+            r.head = info;
+            ++r.count;
+        }
+#else
+        ;
+#endif
+
+        auto LIFETIME_OUT_OF_LINE unlink(lifetime_detail::control_info* info) -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+        {
+            registry& r = get_registry();
+            std::scoped_lock<std::mutex> lock(r.mutex);
+            if(info->live_prev != nullptr) info->live_prev->live_next = info->live_next;
+            else r.head = info->live_next;
+            if(info->live_next != nullptr) info->live_next->live_prev = info->live_prev;
+            --r.count;
+        }
+#else
+        ;
+#endif
+    }
+
+    // Number of live Lifetimes
+    auto inline live_count() -> std::size_t
+    {
+        detail::registry& r = detail::get_registry();
+        std::scoped_lock<std::mutex> lock(r.mutex);
+        return r.count;
+    }
+
+    // State of every live Lifetime
+    auto inline live_objects() -> std::vector<object_state>
+    {
+        detail::registry& r = detail::get_registry();
+        std::scoped_lock<std::mutex> lock(r.mutex);
+        std::vector<object_state> out;
+        out.reserve(r.count);
+        for(const lifetime_detail::control_info* info = r.head; info != nullptr; info = info->live_next)
+        {
+            object_state state;
+            state.id = info->id;
+            state.type_name = info->type_name;
+#if defined(LIFETIME_SOURCE_LOCATION)
+            state.created_at = info->created_at;
+#endif
+            info->inspect(*info, state);
+            out.push_back(std::move(state));
+        }
+        return out;
+    }
+
+    // Every live Lifetime with its creation site, owner state and outstanding borrows
+    auto inline write_live_report(std::ostream& out) -> void
+    {
+        const std::vector<object_state> objects = live_objects();
+        out << objects.size() << " Lifetime(s) alive\n";
+        for(const auto& object : objects)
+        {
+            out << "Lifetime " << object.id << " <" << object.type_name << ">: \t"
+                << (object.owned ? "owned" : "owner released") << ", " << object.handle_count << " handle(s)"
+                << (object.mutably_borrowed ? ", mutably borrowed" : "") << "\n";
+            out << "Created at:\n" << object.created_at.to_string();
+            for(const auto& handle : object.handles)
+            {
+                if(handle.is_owner) continue;
+                out << (handle.is_mutator ? "Mutable borrow " : "Borrow ") << handle.handle << " at:\n" << handle.site.to_string();
+            }
+        }
+    }
+
+    auto inline live_report() -> std::string
+    {
+        std::stringstream ss;
+        write_live_report(ss);
+        return ss.str();
+    }
+
+    namespace detail {
+
+        auto inline write_dot_label(std::ostream& out, const std::string& label) -> void
+        {
+            out << '"';
+            for(const char c : label)
+            {
+                if(c == '"' || c == '\\') out << '\\' << c;
+                else if(c == '\n') out << "\\n";
+                else out << c;
+            }
+            out << '"';
+        }
+
+        auto inline site_label([[maybe_unused]] const lifetime_site& site) -> std::string
+        {
+#if defined(LIFETIME_SOURCE_LOCATION)
+            std::stringstream ss;
+            ss << "\n" << site.location.file_name() << ":" << site.location.line();
+            return ss.str();
+#else
+            return std::string();
+#endif
+        }
+    }
+
+    // Ownership graph of the live Lifetimes in Graphviz DOT: one cluster per object,
+    // owner -> borrower edges, mutable borrows highlighted in red
+    auto inline dump_graph(std::ostream& out) -> void
+    {
+        const std::vector<object_state> objects = live_objects();
+        out << "digraph lifetimes {\n";
+        out << "  node [shape=box, fontname=\"monospace\"];\n";
+        std::size_t index = 0U;
+        for(const auto& object : objects)
+        {
+            std::stringstream label;
+            label << object.type_name << " @ " << object.id << detail::site_label(object.created_at) << "\n" << object.handle_count << " handle(s)";
+            if(!object.tracked) label << " (untracked)";
+            if(!object.owned) label << "\nowner released";
+
+            out << "  subgraph cluster_" << index++ << " {\n";
+            out << "    \"" << object.id << "\" [shape=ellipse, label=";
+            detail::write_dot_label(out, label.str());
+            out << (object.owned ? "" : ", color=orange") << "];\n";
+
+            // Edges start at the owner handle, or at the object itself once the owner is gone
+            const void* from = object.id;
+            for(const auto& handle : object.handles)
+            {
+                if(!handle.is_owner) continue;
+                from = handle.handle;
+                out << "    \"" << handle.handle << "\" [label=";
+                detail::write_dot_label(out, "owner" + detail::site_label(handle.site));
+                out << ", style=bold];\n";
+                out << "    \"" << object.id << "\" -> \"" << handle.handle << "\" [style=dotted, arrowhead=none];\n";
+            }
+            for(const auto& handle : object.handles)
+            {
+                if(handle.is_owner) continue;
+                out << "    \"" << handle.handle << "\" [label=";
+                detail::write_dot_label(out, (handle.is_mutator ? "mutable borrow" : "borrow") + detail::site_label(handle.site));
+                out << (handle.is_mutator ? ", color=red, fontcolor=red" : "") << "];\n";
+                out << "    \"" << from << "\" -> \"" << handle.handle << "\"" << (handle.is_mutator ? " [color=red, penwidth=2]" : "") << ";\n";
+            }
+            out << "  }\n";
+        }
+        out << "}\n";
+    }
+
+    // Write live_report() to stderr at exit if Lifetimes are still alive (default on)
+    auto inline set_report_at_exit(bool enabled) noexcept -> void
+    {
+        detail::get_registry().report_at_exit.store(enabled, std::memory_order_relaxed);
+    }
+
+    auto inline detail::write_at_exit() -> void
+    {
+        if(!get_registry().report_at_exit.load(std::memory_order_relaxed) || live_count() == 0U) return;
+        const std::string report = "Lifetime leak report: " + live_report();
+        std::fputs(report.c_str(), stderr);
+    }
+}
+#endif
+
+#if defined(LIFETIME_STATS) || defined(LIFETIME_PROFILE_LOCKS)
+// Prometheus / OpenMetrics text exposition of the enabled Lifetime metrics
+// (lifetime_stats counters with LIFETIME_STATS, lock histograms with LIFETIME_PROFILE_LOCKS)
+namespace lifetime_metrics {
+
+    namespace detail {
+
+#if defined(LIFETIME_PROFILE_LOCKS)
+        auto inline write_histogram(std::ostream& out, const char* name, const char* help, const lifetime_profile::detail::histogram& h) -> void
+        {
+            const std::streamsize precision = out.precision(12);
+            out << "# HELP " << name << ' ' << help << "\n";
+            out << "# TYPE " << name << " histogram\n";
+            std::uint64_t cumulative = 0U;
+            for(unsigned i = 0; i < lifetime_profile::detail::histogram_buckets; ++i)
+            {
+                cumulative += h.buckets[i].load(std::memory_order_relaxed);
+                out << name << "_bucket{le=\"";
+                if(i + 1U == lifetime_profile::detail::histogram_buckets) out << "+Inf";
+                else out << static_cast<double>(std::uint64_t{1} << (i + 10U)) / 1e9;
+                out << "\"} " << cumulative << "\n";
+            }
+            out << name << "_sum " << static_cast<double>(h.sum_ns.load(std::memory_order_relaxed)) / 1e9 << "\n";
+            out << name << "_count " << h.count.load(std::memory_order_relaxed) << "\n";
+            out.precision(precision);
+        }
+#endif
+    }
+
+    auto inline write_prometheus(std::ostream& out) -> void
+    {
+#if defined(LIFETIME_STATS)
+        const lifetime_stats::counters c = lifetime_stats::snapshot();
+        out << "# HELP lifetime_live Lifetimes currently alive.\n# TYPE lifetime_live gauge\n"
+            << "lifetime_live " << c.live << "\n";
+        out << "# HELP lifetime_created_total Lifetimes created.\n# TYPE lifetime_created_total counter\n"
+            << "lifetime_created_total " << c.created << "\n";
+        out << "# HELP lifetime_destroyed_total Lifetimes freed.\n# TYPE lifetime_destroyed_total counter\n"
+            << "lifetime_destroyed_total " << c.destroyed << "\n";
+        out << "# HELP lifetime_borrows_total Borrows taken.\n# TYPE lifetime_borrows_total counter\n"
+            << "lifetime_borrows_total{kind=\"shared\"} " << c.shared_borrows << "\n"
+            << "lifetime_borrows_total{kind=\"mutable\"} " << c.mutable_borrows << "\n";
+        out << "# HELP lifetime_violations_total Borrow and ownership violations.\n# TYPE lifetime_violations_total counter\n";
+        for(unsigned i = 0; i < static_cast<unsigned>(lifetime_violation::count); ++i)
+            out << "lifetime_violations_total{kind=\"" << lifetime_violation_name(static_cast<lifetime_violation>(i)) << "\"} " << c.violations[i] << "\n";
+        out << "# HELP lifetime_peak_borrow_fan_out Most handles seen on one Lifetime.\n# TYPE lifetime_peak_borrow_fan_out gauge\n"
+            << "lifetime_peak_borrow_fan_out " << c.peak_fan_out << "\n";
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        const std::vector<lifetime_stats::type_counters> types = lifetime_stats::by_type();
+        out << "# HELP lifetime_type_live Lifetimes currently alive, by type.\n# TYPE lifetime_type_live gauge\n";
+        for(const auto& t : types)
+            out << "lifetime_type_live{type=\"" << t.type_name << "\"} " << t.live << "\n";
+        out << "# HELP lifetime_type_live_bytes Bytes of values held by live Lifetimes, by type.\n# TYPE lifetime_type_live_bytes gauge\n";
+        for(const auto& t : types)
+            out << "lifetime_type_live_bytes{type=\"" << t.type_name << "\"} " << t.live_bytes << "\n";
+        out << "# HELP lifetime_type_borrows_total Borrows taken, by type.\n# TYPE lifetime_type_borrows_total counter\n";
+        for(const auto& t : types)
+        {
+            out << "lifetime_type_borrows_total{type=\"" << t.type_name << "\",kind=\"shared\"} " << t.shared_borrows << "\n";
+            out << "lifetime_type_borrows_total{type=\"" << t.type_name << "\",kind=\"mutable\"} " << t.mutable_borrows << "\n";
+        }
+#if defined(LIFETIME_PROFILE_LOCKS)
+        out << "# HELP lifetime_type_lock_wait_seconds_total Sampled time spent waiting for Lifetime mutexes, by type.\n# TYPE lifetime_type_lock_wait_seconds_total counter\n";
+        for(const auto& t : types)
+            out << "lifetime_type_lock_wait_seconds_total{type=\"" << t.type_name << "\"} " << static_cast<double>(t.lock_wait_ns) / 1e9 << "\n";
+#endif
+#endif
+#if defined(LIFETIME_PROFILE_LOCKS)
+        const lifetime_profile::detail::profiler& p = lifetime_profile::detail::get_profiler();
+        out << "# HELP lifetime_lock_sample_rate One in this many lock acquisitions is timed.\n# TYPE lifetime_lock_sample_rate gauge\n"
+            << "lifetime_lock_sample_rate " << lifetime_profile::sample_rate() << "\n";
+        detail::write_histogram(out, "lifetime_lock_wait_seconds", "Sampled time spent waiting for a Lifetime mutex.", p.wait);
+        detail::write_histogram(out, "lifetime_lock_hold_seconds", "Sampled time a Lifetime mutex was held.", p.hold);
+#endif
+    }
+
+    auto inline prometheus_text() -> std::string
+    {
+        std::stringstream ss;
+        write_prometheus(ss);
+        return ss.str();
+    }
+
+    // Write to `path` through a temporary file, so a scraper never sees a partial file
+    auto inline write_prometheus(const std::string& path) -> bool
+    {
+        const std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary);
+            if(!file) return false;
+            write_prometheus(file);
+            if(!file) return false;
+        }
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+}
+#endif
+
+// Instrumentation hooks (compile to nothing unless a feature is enabled)
+namespace lifetime_detail {
+
+    auto inline on_create([[maybe_unused]] control_info* info) noexcept -> void
+    {
+#if defined(LIFETIME_STATS)
+        lifetime_stats::detail::bump(lifetime_stats::detail::local().created);
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        info->type->created.fetch_add(1U, std::memory_order_relaxed);
+        info->type->live_bytes.fetch_add(info->value_size, std::memory_order_relaxed);
+#endif
+#if defined(LIFETIME_HEAP_PROFILE)
+        lifetime_heap::detail::on_create(info->site, info->value_size);
+#endif
+    }
+
+    auto inline on_destroy([[maybe_unused]] control_info* info) -> void
+    {
+#if defined(LIFETIME_REGISTRY)
+        lifetime_debug::detail::unlink(info);
+#endif
+#if defined(LIFETIME_STATS)
+        lifetime_stats::detail::bump(lifetime_stats::detail::local().destroyed);
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        info->type->live_bytes.fetch_sub(info->value_size, std::memory_order_relaxed);
+        info->type->destroyed.fetch_add(1U, std::memory_order_relaxed);
+#endif
+#if defined(LIFETIME_HEAP_PROFILE)
+        lifetime_heap::detail::on_destroy(info->site, info->value_size);
+#endif
+#if defined(LIFETIME_PROFILE_LOCKS)
+        lifetime_profile::detail::unlink(info);
+#endif
+        delete info;
+    }
+
+    auto inline on_borrow([[maybe_unused]] control_info* info, [[maybe_unused]] std::size_t fan_out) noexcept -> void
+    {
+#if defined(LIFETIME_STATS)
+        auto& local = lifetime_stats::detail::local();
+        lifetime_stats::detail::bump(local.shared_borrows);
+        lifetime_stats::detail::raise(local.peak_fan_out, fan_out);
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        info->type->shared_borrows.fetch_add(1U, std::memory_order_relaxed);
+#endif
+    }
+
+    auto inline on_borrow_mutable([[maybe_unused]] control_info* info, [[maybe_unused]] std::size_t fan_out) noexcept -> void
+    {
+#if defined(LIFETIME_STATS)
+        auto& local = lifetime_stats::detail::local();
+        lifetime_stats::detail::bump(local.mutable_borrows);
+        lifetime_stats::detail::raise(local.peak_fan_out, fan_out);
+#endif
+#if defined(LIFETIME_TYPE_STATS)
+        info->type->mutable_borrows.fetch_add(1U, std::memory_order_relaxed);
+#endif
+    }
+
+    auto inline on_violation([[maybe_unused]] lifetime_violation kind) noexcept -> void
+    {
+#if defined(LIFETIME_STATS)
+        lifetime_stats::detail::bump(lifetime_stats::detail::local().violations[static_cast<unsigned>(kind)]);
+#endif
+#if defined(LIFETIME_RECORD)
+        if(lifetime_record::is_enabled()) lifetime_record::detail::log(lifetime_op::violation, 0U, 0U, static_cast<std::uint32_t>(kind));
+#endif
+    }
+
+    // A new handle (create, borrow, borrow_mutable or move); numbers it if recording
+    auto inline on_handle([[maybe_unused]] lifetime_op op, [[maybe_unused]] control_info* info, [[maybe_unused]] record_id& handle, [[maybe_unused]] std::uint32_t aux) noexcept -> void
+    {
+#if defined(LIFETIME_RECORD)
+        if(!lifetime_record::is_enabled()) return;
+        auto& r = lifetime_record::detail::get_recorder();
+        if(op == lifetime_op::create) info->record_object = r.next_object.fetch_add(1U, std::memory_order_relaxed);
+        if(info->record_object == 0U) return;
+        handle.value = r.next_handle.fetch_add(1U, std::memory_order_relaxed);
+        lifetime_record::detail::log(op, info->record_object, handle.value, aux);
+#endif
+    }
+
+    // An operation on an existing handle (logged before it is checked, so a replay raises
+    // the same violations); move_to names the handle giving up ownership as `from`
+    auto inline on_operation([[maybe_unused]] lifetime_op op, [[maybe_unused]] const control_info* info, [[maybe_unused]] const record_id& handle, [[maybe_unused]] const record_id& from = record_id()) noexcept -> void
+    {
+#if defined(LIFETIME_RECORD)
+        if(handle.value != 0U && lifetime_record::is_enabled())
+            lifetime_record::detail::log(op, info->record_object, handle.value, from.value);
+#endif
+    }
+
+#if defined(LIFETIME_STAMP_BORROWS)
+    auto inline on_acquire(borrow_stamp& stamp, bool is_mutable, [[maybe_unused]] const void* id, [[maybe_unused]] const char* type_name, [[maybe_unused]] const lifetime_site& site) noexcept -> void
+    {
+        stamp.acquired = now_ns();
+        stamp.thread = thread_index();
+        stamp.is_mutable = is_mutable;
+#if defined(LIFETIME_TRACK_BORROWS)
+        stamp.id = id;
+        stamp.type_name = type_name;
+        stamp.site = &site;
+        lifetime_long_borrows::detail::hold(stamp);
+#endif
+    }
+
+    // A borrow handle is released
+    auto inline on_release(const void* id, const char* type_name, borrow_stamp& stamp, const lifetime_site& site) -> void
+    {
+        const std::uint64_t released = now_ns();
+#if defined(LIFETIME_TRACK_BORROWS)
+        lifetime_long_borrows::detail::unhold(stamp);
+#endif
+#if defined(LIFETIME_TRACE)
+        if(lifetime_trace::is_enabled())
+        {
+            lifetime_trace::span span;
+            span.id = id;
+            span.type_name = type_name;
+            span.is_mutable = stamp.is_mutable;
+            span.thread = stamp.thread;
+            span.begin_ns = stamp.acquired;
+            span.end_ns = released;
+            span.site = site;
+            lifetime_trace::detail::record(span);
+        }
+#endif
+#if defined(LIFETIME_TRACK_BORROWS)
+        const std::uint64_t held = released - stamp.acquired;
+        if(held > lifetime_long_borrows::detail::get_detector().threshold_ns.load(std::memory_order_relaxed))
+        {
+            lifetime_long_borrows::long_borrow borrow;
+            borrow.id = id;
+            borrow.type_name = type_name;
+            borrow.is_mutable = stamp.is_mutable;
+            borrow.held_ns = held;
+            borrow.site = site;
+            lifetime_long_borrows::detail::flag(borrow);
+        }
+#endif
+    }
+#endif
+
+    // Times one Lifetime operation until stop() or the end of its scope (empty without
+    // LIFETIME_OP_TIMERS)
+    class op_timer {
+    public:
+#if defined(LIFETIME_OP_TIMERS)
+        explicit op_timer(lifetime_op op) noexcept : m_op(op), m_start(lifetime_timers::detail::ticks()) {}
+
+        ~op_timer()
+        {
+            this->stop();
+        }
+
+        auto stop() noexcept -> void
+        {
+            if(this->m_start == 0U) return;
+            lifetime_timers::detail::record(this->m_op, lifetime_timers::detail::ticks() - this->m_start);
+            this->m_start = 0U;
+        }
+#else
+        explicit op_timer(lifetime_op) noexcept {}
+
+        auto stop() noexcept -> void {}
+#endif
+
+        op_timer(op_timer const&) = delete;
+        void operator=(op_timer const&) = delete;
+
+#if defined(LIFETIME_OP_TIMERS)
+    private:
+        lifetime_op m_op;
+        std::uint64_t m_start;
+#endif
+    };
+
+    // Locks a Lifetime's mutex, timing sampled acquisitions
+    class lock_guard {
+    public:
+        lock_guard(std::mutex& mutex, [[maybe_unused]] control_info* info) : m_mutex(mutex)
+        {
+#if defined(LIFETIME_PROFILE_LOCKS)
+            if(info != nullptr && lifetime_profile::detail::should_sample())
+            {
+                this->m_info = info;
+                const std::uint64_t start = lifetime_detail::now_ns();
+                this->m_mutex.lock();
+                this->m_acquired = lifetime_detail::now_ns();
+
+                const std::uint64_t wait = this->m_acquired - start;
+                contention_record& c = info->contention;
+                c.samples.fetch_add(1U, std::memory_order_relaxed);
+                c.wait_ns.fetch_add(wait, std::memory_order_relaxed);
+                std::uint64_t max = c.max_wait_ns.load(std::memory_order_relaxed);
+                while(wait > max && !c.max_wait_ns.compare_exchange_weak(max, wait, std::memory_order_relaxed));
+                lifetime_profile::detail::get_profiler().wait.record(wait);
+#if defined(LIFETIME_TYPE_STATS)
+                info->type->lock_samples.fetch_add(1U, std::memory_order_relaxed);
+                info->type->lock_wait_ns.fetch_add(wait, std::memory_order_relaxed);
+#endif
+                if(!info->profiled.load(std::memory_order_relaxed)) lifetime_profile::detail::link(info);
+                return;
+            }
+#endif
+            this->m_mutex.lock();
+        }
+
+        ~lock_guard()
+        {
+#if defined(LIFETIME_PROFILE_LOCKS)
+            if(this->m_info != nullptr)
+            {
+                const std::uint64_t hold = lifetime_detail::now_ns() - this->m_acquired;
+                this->m_mutex.unlock();
+                this->m_info->contention.hold_ns.fetch_add(hold, std::memory_order_relaxed);
+                lifetime_profile::detail::get_profiler().hold.record(hold);
+                return;
+            }
+#endif
+            this->m_mutex.unlock();
+        }
+
+        lock_guard(lock_guard const&) = delete;
+        void operator=(lock_guard const&) = delete;
+
+    private:
+        std::mutex& m_mutex;
+#if defined(LIFETIME_PROFILE_LOCKS)
+        control_info* m_info = nullptr;
+        std::uint64_t m_acquired = 0;
+#endif
+    };
+
+    // Should a new Lifetime get full validation?
+    auto inline should_track() noexcept -> bool
+    {
+        if(lifetime_checks::level() != lifetime_check_level::full) return false;
+#if defined(LIFETIME_SAMPLED_CHECKS)
+        thread_local std::uint32_t tick = 0;
+        const std::uint32_t rate = lifetime_sampling::rate();
+        if(rate == 0U) return false;
+        if(++tick < rate) return false;
+        tick = 0;
+#endif
+        return true;
+    }
+
+    // Record and report a violation (returns only when checking is off or the handler returns)
+    LIFETIME_COLD auto LIFETIME_OUT_OF_LINE violate(lifetime_violation kind, const char* what) -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+    {
+        LIFETIME_PROBE2(violation, static_cast<int>(kind), what);
+        if(lifetime_checks::level() == lifetime_check_level::off) return;
+        on_violation(kind);
+        lifetime_checks::detail::report(kind, what);
+    }
+#else
+    ;
+#endif
+
+    LIFETIME_COLD auto LIFETIME_OUT_OF_LINE violate(lifetime_violation kind, const std::string& what) -> void
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+    {
+        violate(kind, what.c_str());
+    }
+#else
+    ;
+#endif
+
+    // Violation message naming the call site, the creator and the conflicting holder (if any)
+    LIFETIME_COLD auto LIFETIME_OUT_OF_LINE describe([[maybe_unused]] const char* what, [[maybe_unused]] const lifetime_site& at, [[maybe_unused]] const control_info* info, [[maybe_unused]] const lifetime_site* holder) -> std::string
+#if !defined(LIFETIME_COMPILED_LIB) || defined(LIFETIME_IMPLEMENTATION)
+    {
+#if defined(LIFETIME_SOURCE_LOCATION)
+        std::string out = what;
+        out += "\nAt:\n" + at.to_string();
+        if(info != nullptr) out += "Created at:\n" + info->created_at.to_string();
+        if(holder != nullptr) out += "Held at:\n" + holder->to_string();
+        return out;
+#else
+        return what;
+#endif
+    }
+#else
+    ;
+#endif
+}
+
+// What Lifetime can skip for a given T (specialise to override)
+// is_immutable: Lifetime<const T> has no writers, so it needs no mutex or mutator slot and
+//               offers no get_mutable / set / borrow_mutable.
+// copy_borrows: a shared borrow is as good as a copy of the value (immutable, trivially
+//               copyable and small), so lifetime_static::Borrowed<T> holds one by value.
+template<class T>
+struct lifetime_traits {
+    constexpr static bool is_immutable = std::is_const_v<T>;
+    constexpr static bool copy_borrows = std::is_const_v<T> && std::is_trivially_copyable_v<T> && sizeof(T) <= 2U * sizeof(void*);
+};
+
+// Similar to a std::shared_ptr<T>
+
+template<class T>
+class Lifetime {
+public:
+    class LifetimeMutator;
+
+    constexpr static bool is_immutable = lifetime_traits<T>::is_immutable;
+
+    // Handles sharing one object (individually tracked only for sampled Lifetimes)
+    struct LifetimeRefs {
+        std::set<Lifetime*> handles;
+        std::size_t count = 0U;
+        bool tracked = true;
+        // Live LifetimeRanges, and the number of mutable accesses (written under the mutex)
+        std::atomic<std::size_t> ranges{0U};
+        std::atomic<std::size_t> generation{0U};
+    };
+
+    // Constructor (a new Lifetime)
+    Lifetime(T* child, Lifetime** ownership, LifetimeMutator** mutator, std::mutex* mut, LifetimeRefs* set, lifetime_detail::control_info* info, bool force_take_ownership = false, bool force_take_mutability = false, lifetime_site site = lifetime_site()) noexcept
+    {
+        this->m_T = child;
+        if constexpr(is_immutable)
+        {
+            // Nothing can write, so there is nothing to lock or hand out
+            this->m_mutator = nullptr;
+            this->m_mutex = nullptr;
+        }
+        else
+        {
+            this->m_mutator = (mutator == nullptr) ? new LifetimeMutator*{nullptr} : mutator;
+            if(force_take_mutability && *this->m_mutator == nullptr)
+                new LifetimeMutator(this, this->m_mutator);
+            this->m_mutex = (mut == nullptr ? new std::mutex : mut);
+        }
+        this->m_owner = (ownership == nullptr ? new Lifetime*{this} : ownership);
+        if(force_take_ownership && *this->m_owner != this) *this->m_owner = this;
+        if(set == nullptr)
+        {
+            this->m_refs = new LifetimeRefs;
+            this->m_refs->tracked = lifetime_detail::should_track();
+        } else this->m_refs = set;
+        ++this->m_refs->count;
+        if(this->m_refs->tracked) this->m_refs->handles.insert(this);
+        this->m_info = info;
+        this->m_site = site;
+        if(set == nullptr)
+        {
+            this->m_info = lifetime_detail::make_info(*this->m_T, this->m_refs, site);
+#if defined(LIFETIME_REGISTRY)
+            this->m_info->owner = this->m_owner;
+            this->m_info->mutator = this->m_mutator;
+            this->m_info->refs = this->m_refs;
+            this->m_info->inspect = &Lifetime::inspect;
+            lifetime_debug::detail::link(this->m_info);
+#endif
+#if defined(LIFETIME_HEAP_PROFILE)
+            this->m_info->site = lifetime_heap::detail::entry_for(site, this->m_info->type_name, sizeof(std::remove_extent_t<typename lifetime_detail::value_report<T>::type>), sizeof(Lifetime*) + sizeof(LifetimeMutator*) + sizeof(std::mutex) + sizeof(LifetimeRefs) + sizeof(lifetime_detail::control_info));
+#endif
+            lifetime_detail::on_create(this->m_info);
+            lifetime_detail::on_handle(lifetime_op::create, this->m_info, this->m_record, static_cast<std::uint32_t>(lifetime_detail::value_report<T>::size(*this->m_T)));
+            LIFETIME_PROBE3(create, this->m_refs, typeid(typename lifetime_detail::value_report<T>::type).name(), lifetime_detail::value_report<T>::size(*this->m_T));
+        }
+        else if(force_take_ownership)
+        {
+            lifetime_detail::on_handle(lifetime_op::move, this->m_info, this->m_record, 0U);
+            LIFETIME_PROBE2(move, this->m_refs, this);
+        }
+        else
+        {
+            lifetime_detail::on_handle(force_take_mutability ? lifetime_op::borrow_mutable : lifetime_op::borrow, this->m_info, this->m_record, static_cast<std::uint32_t>(this->m_refs->count));
+            if(force_take_mutability) LIFETIME_PROBE3(borrow_mutable, this->m_refs, this, this->m_refs->count);
+            else LIFETIME_PROBE3(borrow, this->m_refs, this, this->m_refs->count);
+#if defined(LIFETIME_STAMP_BORROWS)
+            lifetime_detail::on_acquire(this->m_stamp, force_take_mutability, this->m_refs, lifetime_detail::type_name<T>(), this->m_site);
+#endif
+        }
+    }
+
+    // Destructor (disable noexcept)
+    ~Lifetime() noexcept(false)
+    {
+        assert(this->m_T != nullptr);
+        assert(this->m_owner != nullptr);
+        assert(this->m_refs != nullptr);
+        assert(is_immutable || this->m_mutator != nullptr);
+
+        lifetime_detail::op_timer timer(lifetime_op::release);
+        LIFETIME_PROBE2(release, this->m_refs, this);
+        lifetime_detail::on_operation(lifetime_op::release, this->m_info, this->m_record);
+
+        // Remove mutability
+        if(this->is_mutator()) delete *this->m_mutator;
+
+#if defined(LIFETIME_STAMP_BORROWS)
+        this->end_borrow();
+#endif
+
+        // Remove
+        --this->m_refs->count;
+        if(this->m_refs->tracked) this->m_refs->handles.erase(this);
+
+        // The remaining borrows are left without an owner. The cell is cleared before the
+        // violation is reported, since reporting may throw.
+        std::string orphaned;
+        if(this == *this->m_owner && this->m_refs->count > 0U)
+        {
+            orphaned = this->report("Owner freed but references still exist.", this->m_site, this->m_refs->tracked ? &(*this->m_refs->handles.begin())->m_site : nullptr);
+            *this->m_owner = nullptr;
+        }
+
+        // Delete
+        if(this->m_refs->count == 0U)
+        {
+            LIFETIME_PROBE1(destroy, this->m_refs);
+            lifetime_detail::on_destroy(this->m_info);
+            delete this->m_T;
+            delete this->m_owner;
+            delete this->m_mutator;
+            delete this->m_mutex;
+            delete this->m_refs;
+            timer.stop();
+#if defined(LIFETIME_PRINT_DELETES)
+            std::fputs("Lifetime deleted.\n", stdout);
+#endif
+        }
+
+        // Reset
+        this->m_T = nullptr;
+        this->m_owner = nullptr;
+        this->m_mutator = nullptr;
+        this->m_mutex = nullptr;
+        this->m_refs = nullptr;
+        this->m_info = nullptr;
+
+        if(!orphaned.empty()) lifetime_detail::violate(lifetime_violation::owner_freed_with_references, orphaned);
+    }
+
+    // Disable copying
+    Lifetime(Lifetime const&) = delete;
+    void operator=(Lifetime const &x) = delete;
+
+    // Create a new Lifetime
+    auto static from(T&& value, lifetime_site site = lifetime_site()) noexcept -> Lifetime<T>
+    {
+        return Lifetime<T>(new T{value}, nullptr, nullptr, nullptr, nullptr, nullptr, false, false, site);
+    }
+
+    // Get mutable
+    auto get_mutable([[maybe_unused]] lifetime_site site = lifetime_site()) -> T& LIFETIME_REQUIRES(!is_immutable)
+    {
+        static_assert(!is_immutable, "Lifetime<const T> has no mutable access");
+        lifetime_detail::op_timer timer(lifetime_op::get_mutable);
+        assert(this->m_T != nullptr);
+        assert(this->m_owner != nullptr);
+        assert(this->m_mutator != nullptr);
+        assert(this->m_mutex != nullptr);
+
+        lifetime_detail::on_operation(lifetime_op::get_mutable, this->m_info, this->m_record);
+        if(*this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this);
+        else if(this != *this->m_owner) lifetime_detail::violate(lifetime_violation::mutable_without_ownership, this->report("Lifetime tried to get a mutable reference without maintaining object ownership or mutability.", site, nullptr));
+        this->check_ranges(site);
+        
+        lifetime_detail::lock_guard lock(*this->m_mutex, this->m_info);
+        this->advance_generation();
+
+        return *this->m_T;
+    }
+
+    // Set new value
+    auto set(T&& value, [[maybe_unused]] lifetime_site site = lifetime_site()) LIFETIME_REQUIRES(!is_immutable)
+    {
+        static_assert(!is_immutable, "Lifetime<const T> has no mutable access");
+        lifetime_detail::op_timer timer(lifetime_op::set);
+        assert(this->m_T != nullptr);
+        assert(this->m_owner != nullptr);
+        assert(this->m_mutator != nullptr);
+        assert(this->m_mutex != nullptr);
+
+        lifetime_detail::on_operation(lifetime_op::set, this->m_info, this->m_record);
+        if(*this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this);
+        else if(this != *this->m_owner) lifetime_detail::violate(lifetime_violation::write_without_ownership, this->report("Lifetime tried to write a new value without maintaining object ownership or mutability.", site, nullptr));
+        this->check_ranges(site);
+
+        lifetime_detail::lock_guard lock(*this->m_mutex, this->m_info);
+        this->advance_generation();
+        timer.stop();
+
+        *this->m_T = value;
+    }
+
+    // Get the value
+    auto get() noexcept -> const T&
+    {
+        lifetime_detail::on_operation(lifetime_op::get, this->m_info, this->m_record);
+        return *this->m_T;
+    }
+
+    // Borrow
+    auto borrow(lifetime_site site = lifetime_site()) noexcept -> Lifetime<T>
+    {
+        lifetime_detail::op_timer timer(lifetime_op::borrow);
+        lifetime_detail::on_borrow(this->m_info, this->m_refs->count + 1U);
+        return Lifetime<T>(this->m_T, this->m_owner, this->m_mutator, this->m_mutex, this->m_refs, this->m_info, false, false, site);
+    }
+
+    // Borrow mutable
+    auto borrow_mutable(lifetime_site site = lifetime_site()) -> Lifetime<T> LIFETIME_REQUIRES(!is_immutable)
+    {
+        static_assert(!is_immutable, "Lifetime<const T> has no mutable access");
+        lifetime_detail::op_timer timer(lifetime_op::borrow_mutable);
+        assert(this->m_mutator != nullptr);
+
+        if(*this->m_mutator != nullptr) lifetime_detail::violate(lifetime_violation::mutable_borrow_exists, this->report("Tried to borrow mutable access from a Lifetime for which mutable access already exists.", site, &(*this->m_mutator)->m_mutator->m_site));
+
+        lifetime_detail::on_borrow_mutable(this->m_info, this->m_refs->count + 1U);
+
+        return Lifetime<T>(this->m_T, this->m_owner, this->m_mutator, this->m_mutex, this->m_refs, this->m_info, false, true, site);
+    }
+
+    // Clone
+    auto clone(lifetime_site site = lifetime_site()) noexcept -> Lifetime<T>
+    {
+        T _T = *this->m_T;
+        return Lifetime<T>::from(std::move(_T), site);
+    }
+
+    // Get mutability
+    auto is_mutator() noexcept -> bool
+    {
+        if constexpr(is_immutable) return false;
+        else return *this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this;
+    }
+
+    // Get ownership
+    auto is_owner() noexcept -> bool
+    {
+        return this == *this->m_owner;
+    }
+
+    // Handle of the same object?
+    auto shares_object(const Lifetime& other) const noexcept -> bool
+    {
+        return this->m_refs == other.m_refs;
+    }
+
+    // Borrow the value for checked iteration
+    // (a template, so explicit instantiations of Lifetime<T> for non-containers skip it)
+    template<class U = T, std::enable_if_t<lifetime_detail::is_iterable<const U>, int> = 0>
+    auto range(lifetime_site site = lifetime_site()) -> LifetimeRange<const T, T>
+    {
+        return LifetimeRange<const T, T>(*this, site);
+    }
+
+    // Borrow the value mutable for checked iteration
+    template<class U = T, std::enable_if_t<!lifetime_traits<U>::is_immutable && lifetime_detail::is_iterable<U>, int> = 0>
+    auto range_mutable(lifetime_site site = lifetime_site()) -> LifetimeRange<T, T>
+    {
+        return LifetimeRange<T, T>(*this, site);
+    }
+
+    // Move to
+    auto move(Lifetime& lifetime, [[maybe_unused]] lifetime_site site = lifetime_site()) -> void
+    {
+        assert(this->m_owner != nullptr);
+        assert(this->m_refs != nullptr);
+        assert(is_immutable || this->m_mutator != nullptr);
+
+        lifetime_detail::on_operation(lifetime_op::move_to, this->m_info, lifetime.m_record, this->m_record);
+        if(this != *this->m_owner) lifetime_detail::violate(lifetime_violation::move_without_ownership, this->report("Lifetime tried to transfer ownership without maintaining object ownership.", site, this->owner_site()));
+        
+        if(this == &lifetime) lifetime_detail::violate(lifetime_violation::move_to_self, this->report("Lifetime tried to transfer ownership to the same instance.", site, nullptr));
+
+        if(lifetime.m_refs == this->m_refs)
+        {
+
+            // Remove mutability
+            if(this->is_mutator()) delete *this->m_mutator;
+
+            // Transfer ownership
+            *this->m_owner = &lifetime;
+            LIFETIME_PROBE2(move, this->m_refs, &lifetime);
+#if defined(LIFETIME_STAMP_BORROWS)
+            // The new owner is no longer a borrow
+            lifetime.end_borrow();
+#endif
+        } else lifetime_detail::violate(lifetime_violation::move_to_foreign, this->report("Lifetime tried to transfer ownership to a different Lifetime.", site, nullptr));
+    }
+
+    // Move
+    auto move([[maybe_unused]] lifetime_site site = lifetime_site()) -> Lifetime<T>
+    {
+        assert(this->m_T != nullptr);
+        assert(this->m_owner != nullptr);
+        assert(this->m_refs != nullptr);
+        assert(is_immutable || this->m_mutator != nullptr);
+
+        if(this != *this->m_owner) lifetime_detail::violate(lifetime_violation::move_without_ownership, this->report("Lifetime tried to transfer ownership without maintaining object ownership.", site, this->owner_site()));
+        return Lifetime<T>(this->m_T, this->m_owner, this->m_mutator, this->m_mutex, this->m_refs, this->m_info, true, false, site);
+    }
+
+    class LifetimeMutator {
+    public:
+        friend class Lifetime;
+
+        LifetimeMutator(Lifetime* mutator, LifetimeMutator** mutator_access)
+        {
+            this->m_mutator = mutator;
+            this->m_mutatorAccess = mutator_access;
+            *this->m_mutatorAccess = this;
+        }
+
+        ~LifetimeMutator()
+        {
+            this->m_mutator = nullptr;
+            *this->m_mutatorAccess = nullptr;
+        }
+    
+    protected:
+        Lifetime* m_mutator = nullptr;
+        LifetimeMutator** m_mutatorAccess = nullptr;
+    };
+
+    protected:
+#if defined(LIFETIME_REGISTRY)
+    // Read the shared cells of a live object for lifetime_debug
+    auto static inspect(const lifetime_detail::control_info& info, lifetime_debug::object_state& state) -> void
+    {
+        Lifetime* const owner = *static_cast<Lifetime* const*>(info.owner);
+        const LifetimeMutator* const mutator = info.mutator == nullptr ? nullptr : *static_cast<LifetimeMutator* const*>(info.mutator);
+        const LifetimeRefs* const refs = static_cast<const LifetimeRefs*>(info.refs);
+
+        state.owned = owner != nullptr;
+        state.mutably_borrowed = mutator != nullptr;
+        state.handle_count = refs->count;
+        state.tracked = refs->tracked;
+        for(const Lifetime* handle : refs->handles)
+        {
+            lifetime_debug::handle_state h;
+            h.handle = handle;
+            h.is_owner = handle == owner;
+            h.is_mutator = mutator != nullptr && mutator->m_mutator == handle;
+            h.site = handle->m_site;
+            state.handles.push_back(h);
+        }
+    }
+#endif
+
+    // Violation message (untracked Lifetimes only get the short form)
+    auto report(const char* what, const lifetime_site& at, const lifetime_site* holder) const -> std::string
+    {
+        if(!this->m_refs->tracked || lifetime_checks::level() != lifetime_check_level::full) return what;
+        return lifetime_detail::describe(what, at, this->m_info, holder);
+    }
+
+#if defined(LIFETIME_STAMP_BORROWS)
+    // Closes the borrow this handle was stamped with (on release, or when it becomes the owner)
+    auto end_borrow() -> void
+    {
+        if(this->m_stamp.acquired == 0U) return;
+        lifetime_detail::on_release(this->m_refs, lifetime_detail::type_name<T>(), this->m_stamp, this->m_site);
+        this->m_stamp.acquired = 0U;
+    }
+#endif
+
+    // Creation site of the current owner, if there is one (a destroyed owner clears the cell)
+    auto owner_site() const noexcept -> const lifetime_site*
+    {
+        return *this->m_owner != nullptr ? &(*this->m_owner)->m_site : nullptr;
+    }
+
+    // A mutable access may restructure the value under a live LifetimeRange
+    auto check_ranges([[maybe_unused]] const lifetime_site& site) const -> void
+    {
+        if(this->m_refs->ranges.load(std::memory_order_relaxed) != 0U)
+            lifetime_detail::violate(lifetime_violation::modified_during_range, this->report("Lifetime accessed mutable while a checked range over it is live.", site, nullptr));
+    }
+
+    // Invalidates the ranges taken so far (called with the mutex held)
+    auto advance_generation() const noexcept -> void
+    {
+        this->m_refs->generation.store(this->m_refs->generation.load(std::memory_order_relaxed) + 1U, std::memory_order_relaxed);
+    }
+
+    friend struct lifetime_detail::handle_access;
+
+    mutable T* m_T = nullptr;
+    mutable Lifetime** m_owner = nullptr;
+    mutable std::mutex* m_mutex;
+    mutable LifetimeMutator** m_mutator;
+    mutable LifetimeRefs* m_refs;
+    [[no_unique_address]] mutable lifetime_detail::info_ptr m_info = nullptr;
+    [[no_unique_address]] lifetime_site m_site;
+    [[no_unique_address]] lifetime_detail::record_id m_record;
+#if defined(LIFETIME_STAMP_BORROWS)
+    lifetime_detail::borrow_stamp m_stamp;
+#endif
+
+};
+
+namespace lifetime_detail {
+
+    // What ranges, slices, lifetime_args and lifetime_bulk need from inside a handle (a
+    // Lifetime<T[]> goes through its element block)
+    struct handle_access {
+        template<class T>
+        auto static refs(const Lifetime<T>& handle) noexcept -> auto&
+        {
+            return *handle.m_refs;
+        }
+
+        template<class T>
+        auto static refs(const Lifetime<T[]>& handle) noexcept -> auto&
+        {
+            return handle_access::refs(handle.m_block);
+        }
 
-// TODO: ... Waiting on further compiler support for C++20 & C++23
-// auto inline get_source_position() -> std::string
-// {
-//     const std::source_location location = std::source_location::current();
-//     std::stringstream ss;
-//     ss << "File: \t" << location.filename() << "\n";
-//     ss << "Line/Col: \t" << location.line() << ", " << location.column() << "\n";
-//     ss << "Func: \t" << location.function_name() << "\n";
-//     return ss.str();
-// }
+        // The value, without a check or a recorded operation
+        template<class T>
+        auto static value(const Lifetime<T>& handle) noexcept -> T&
+        {
+            return *handle.m_T;
+        }
 
-// Similar to a std::shared_ptr<T>
+        template<class T>
+        auto static value(const Lifetime<T[]>& handle) noexcept -> auto&
+        {
+            return handle_access::value(handle.m_block);
+        }
 
-template<class T>
-class Lifetime {
+        // Violation message worded as the handle's own checks would (short unless tracked at level full)
+        template<class T>
+        auto static report(const Lifetime<T>& handle, const char* what, const lifetime_site& at) -> std::string
+        {
+            return handle.report(what, at, nullptr);
+        }
+
+        template<class T>
+        auto static report(const Lifetime<T[]>& handle, const char* what, const lifetime_site& at) -> std::string
+        {
+            return handle_access::report(handle.m_block, what, at);
+        }
+    };
+
+    // The borrow behind a LifetimeRange or LifetimeSlice over a handle H (Lifetime<A> or
+    // Lifetime<A[]>), mutable or shared
+    // While it lives, any get_mutable() or set() on the object (from any handle or thread) is a
+    // modified_during_range violation, and valid() tells whether the object was accessed
+    // mutable since the borrow was taken. A source that already is the mutator keeps its
+    // mutability and only a shared borrow is taken.
+    template<class H, bool Mutable>
+    class range_borrow {
+    public:
+        range_borrow(H& source, const lifetime_site& site) : m_handle(range_borrow::take(source, site)), m_site(site)
+        {
+            // The one checked access; value() reads without checks from here on
+            if constexpr(Mutable)
+            {
+                if(this->m_handle.is_mutator()) this->m_handle.get_mutable(site);
+                else source.get_mutable(site);
+            }
+            else this->m_handle.get();
+            handle_access::refs(this->m_handle).ranges.fetch_add(1U, std::memory_order_relaxed);
+            this->m_generation = handle_access::refs(this->m_handle).generation.load(std::memory_order_relaxed);
+        }
+
+        ~range_borrow()
+        {
+            handle_access::refs(this->m_handle).ranges.fetch_sub(1U, std::memory_order_relaxed);
+        }
+
+        // Disable copying
+        range_borrow(range_borrow const&) = delete;
+        void operator=(range_borrow const &x) = delete;
+
+        auto value() const noexcept -> auto&
+        {
+            return handle_access::value(this->m_handle);
+        }
+
+        // No mutable access to the object since the borrow was taken?
+        auto valid() const noexcept -> bool
+        {
+            return handle_access::refs(this->m_handle).generation.load(std::memory_order_relaxed) == this->m_generation;
+        }
+
+        // Reports what if the object was accessed mutable since the borrow was taken
+        auto check(const char* what) const -> void
+        {
+            if(!this->valid())
+                lifetime_detail::violate(lifetime_violation::modified_during_range, handle_access::report(this->m_handle, what, this->m_site));
+        }
+
+    private:
+        auto static take(H& source, const lifetime_site& site) -> H
+        {
+            if constexpr(!Mutable) return source.borrow(site);
+            else if(source.is_mutator()) return source.borrow(site);
+            else return source.borrow_mutable(site);
+        }
+
+        H m_handle;
+        std::size_t m_generation = 0U;
+        [[no_unique_address]] lifetime_site m_site;
+    };
+}
+
+// Borrowed iteration over the value of a Lifetime<A> (a container), with T = const A for a
+// shared borrow and A for a mutable one
+// The iterators are the container's own, so loops over the range compile like loops over the
+// container. Validity is checked once per loop: begin() fails if the container was accessed
+// mutable since the range was taken, and while the range lives any get_mutable() or set()
+// on the object (from any handle or thread) is a modified_during_range violation.
+template<class T, class A>
+class LifetimeRange {
 public:
-    class LifetimeMutator;
+    using iterator = decltype(std::begin(std::declval<T&>()));
 
-    // Constructor (a new Lifetime)
-    Lifetime(T* child, Lifetime** ownership, LifetimeMutator** mutator, std::mutex* mut, std::set<Lifetime*>* set, bool force_take_ownership = false, bool force_take_mutability = false) noexcept
+    LifetimeRange(Lifetime<A>& source, lifetime_site site = lifetime_site()) : m_borrow(source, site)
     {
-        this->m_T = child;
-        this->m_mutator = (mutator == nullptr) ? new LifetimeMutator*{nullptr} : mutator;
-        if(force_take_mutability && *this->m_mutator == nullptr)
-            *this->m_mutator = new LifetimeMutator(this, new LifetimeMutator*{*this->m_mutator});
-        this->m_owner = (ownership == nullptr ? new Lifetime*{this} : ownership);
-        if(force_take_ownership && *this->m_owner != this) *this->m_owner = this;
-        this->m_mutex = (mut == nullptr ? new std::mutex : mut);
-        this->m_refs = (set == nullptr ? new std::set<Lifetime*> : set);
-        this->m_refs->insert(this);
+        T& container = this->m_borrow.value();
+        this->m_begin = std::begin(container);
+        this->m_end = std::end(container);
+    }
+
+    // Disable copying
+    LifetimeRange(LifetimeRange const&) = delete;
+    void operator=(LifetimeRange const &x) = delete;
+
+    auto begin() const -> iterator
+    {
+        this->m_borrow.check("Checked range used after its Lifetime was accessed mutable.");
+        return this->m_begin;
     }
 
+    auto end() const noexcept -> iterator
+    {
+        return this->m_end;
+    }
+
+    // No mutable access to the object since the range was taken?
+    auto valid() const noexcept -> bool
+    {
+        return this->m_borrow.valid();
+    }
+
+private:
+    lifetime_detail::range_borrow<Lifetime<A>, !std::is_const_v<T>> m_borrow;
+    iterator m_begin;
+    iterator m_end;
+};
+
+#if defined(__cpp_constexpr_dynamic_alloc)
+namespace lifetime_detail {
+
+    // Not constexpr: ConstexprLifetime reads it on a violation, which ends constant evaluation
+    inline bool violation_in_constant_expression = true;
+}
+
+// Lifetime for constant evaluation (C++20 constexpr allocation)
+// Same ownership and borrowing rules as Lifetime, but handles are only counted and there is no
+// mutex, so every operation is constexpr and a violation during constant evaluation is a
+// compile error (at runtime it is reported like any Lifetime violation). Allocations cannot
+// outlive constant evaluation: build with it inside a constexpr function and return plain
+// values, e.g. a std::array.
+template<class T>
+class ConstexprLifetime {
+public:
     // Destructor (disable noexcept)
-    ~Lifetime() noexcept(false)
+    constexpr ~ConstexprLifetime() noexcept(false)
     {
-        assert(this->m_T != nullptr);
-        assert(this->m_owner != nullptr);
-        assert(this->m_refs != nullptr);
-        assert(this->m_mutator != nullptr);
+        assert(this->m_cell != nullptr);
 
         // Remove mutability
-        if(*this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this) delete *this->m_mutator;
+        if(this->m_cell->mutator == this->m_id) this->m_cell->mutator = 0U;
 
         // Remove
-        for(const auto& ptr : *this->m_refs)
-        {
-            if(ptr == this)
-            {
-                this->m_refs->erase(ptr);
-                break;
-            }
-        }
+        --this->m_cell->count;
 
-        if(this == *this->m_owner)
+        if(this->m_cell->owner == this->m_id)
         {
-            if(this->m_refs->size() > 0U)
-                throw std::runtime_error("Owner freed but references still exist.");
-            this->m_refs->clear();
+            check(this->m_cell->count == 0U, lifetime_violation::owner_freed_with_references, "Owner freed but references still exist.");
+            // Only reached with checking off: the remaining borrows are left without an owner
+            this->m_cell->owner = 0U;
         }
 
         // Delete
-        if(this->m_refs->empty())
-        {
-            delete this->m_T;
-            delete this->m_owner;
-            delete this->m_refs;
-            std::cout << "Lifetime deleted." << std::endl;
-        }
-
-        // Reset
-        this->m_T = nullptr;
-        this->m_owner = nullptr;
-        this->m_refs = nullptr;
+        if(this->m_cell->count == 0U) delete this->m_cell;
+        this->m_cell = nullptr;
     }
 
     // Disable copying
-    Lifetime(Lifetime const&) = delete;
-    void operator=(Lifetime const &x) = delete;
+    ConstexprLifetime(ConstexprLifetime const&) = delete;
+    void operator=(ConstexprLifetime const &x) = delete;
 
-    // Create a new Lifetime
-    auto static from(T&& value) noexcept -> Lifetime<T>
+    // Create a new ConstexprLifetime
+    constexpr auto static from(T&& value) -> ConstexprLifetime<T>
     {
-        return Lifetime<T>(new T{value}, nullptr, nullptr, nullptr, nullptr);
+        return ConstexprLifetime<T>(new cell{std::move(value), 0U, 0U, 0U, 1U}, true, false);
     }
 
     // Get mutable
-    auto get_mutable() -> T&
+    constexpr auto get_mutable() -> T&
     {
-        assert(this->m_T != nullptr);
-        assert(this->m_owner != nullptr);
-        assert(this->m_mutator != nullptr);
-        assert(this->m_mutex != nullptr);
-
-        if(*this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this);
-        else if(this != *this->m_owner) throw std::runtime_error("Lifetime tried to get a mutable reference without maintaining object ownership or mutability.");
-        
-        std::scoped_lock<std::mutex> lock(*this->m_mutex);
-
-        return *this->m_T;
+        check(this->is_mutator() || this->is_owner(), lifetime_violation::mutable_without_ownership, "Lifetime tried to get a mutable reference without maintaining object ownership or mutability.");
+        return this->m_cell->value;
     }
 
     // Set new value
-    auto set(T&& value)
+    constexpr auto set(T&& value) -> void
     {
-        assert(this->m_T != nullptr);
-        assert(this->m_owner != nullptr);
-        assert(this->m_mutator != nullptr);
-        assert(this->m_mutex != nullptr);
-
-        if(*this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this);
-        else if(this != *this->m_owner) throw std::runtime_error("Lifetime tried to write a new value without maintaining object ownership or mutability.");
-
-        std::scoped_lock<std::mutex> lock(*this->m_mutex);
-
-        *this->m_T = value;
+        check(this->is_mutator() || this->is_owner(), lifetime_violation::write_without_ownership, "Lifetime tried to write a new value without maintaining object ownership or mutability.");
+        this->m_cell->value = std::move(value);
     }
 
     // Get the value
-    auto get() noexcept -> const T&
+    constexpr auto get() const noexcept -> const T&
     {
-        return *this->m_T;
+        return this->m_cell->value;
     }
 
     // Borrow
-    auto borrow() noexcept -> Lifetime<T>
+    constexpr auto borrow() noexcept -> ConstexprLifetime<T>
     {
-        return Lifetime<T>(this->m_T, this->m_owner, this->m_mutator, this->m_mutex, this->m_refs);
+        return ConstexprLifetime<T>(this->m_cell, false, false);
     }
 
     // Borrow mutable
-    auto borrow_mutable() -> Lifetime<T>
+    constexpr auto borrow_mutable() -> ConstexprLifetime<T>
     {
-        assert(this->m_mutator != nullptr);
-
-        if(*this->m_mutator != nullptr) throw std::runtime_error("Tried to borrow mutable access from a Lifetime for which mutable access already exists.");
-
-        return Lifetime<T>(this->m_T, this->m_owner, this->m_mutator, this->m_mutex, this->m_refs, false, true);
+        check(this->m_cell->mutator == 0U, lifetime_violation::mutable_borrow_exists, "Tried to borrow mutable access from a Lifetime for which mutable access already exists.");
+        return ConstexprLifetime<T>(this->m_cell, false, true);
     }
 
     // Clone
-    auto clone() noexcept -> Lifetime<T>
+    constexpr auto clone() const -> ConstexprLifetime<T>
     {
-        T _T = *this->m_T;
-        return Lifetime<T>::from(std::move(_T));
+        T _T = this->m_cell->value;
+        return ConstexprLifetime<T>::from(std::move(_T));
     }
 
     // Get mutability
-    auto is_mutator() noexcept -> bool
+    constexpr auto is_mutator() const noexcept -> bool
     {
-        return this->m_mutator != nullptr && (*this->m_mutator)->m_mutator == this;
+        return this->m_cell->mutator == this->m_id;
     }
 
     // Get ownership
-    auto is_owner() noexcept -> bool
+    constexpr auto is_owner() const noexcept -> bool
     {
-        return this == *this->m_owner;
+        return this->m_cell->owner == this->m_id;
     }
 
-    // Move to
-    auto move(Lifetime& lifetime) -> void
+    // Move ownership to another handle of the same object
+    constexpr auto move(ConstexprLifetime& lifetime) -> void
     {
-        assert(this->m_owner != nullptr);
-        assert(this->m_refs != nullptr);
-        assert(this->m_mutator != nullptr);
-
-        if(this != this->m_owner) throw std::runtime_error("Lifetime tried to transfer ownership without maintaining object ownership.");
-        
-        if(this == &lifetime) throw std::runtime_error("Lifetime tried to transfer ownership to the same instance.");
-
-        if(this->m_refs.contains(&lifetime))
+        check(this->is_owner(), lifetime_violation::move_without_ownership, "Lifetime tried to transfer ownership without maintaining object ownership.");
+        if(lifetime.m_cell != this->m_cell)
         {
+            check(false, lifetime_violation::move_to_foreign, "Lifetime tried to transfer ownership to a different Lifetime.");
+            return;
+        }
+        check(lifetime.m_id != this->m_id, lifetime_violation::move_to_self, "Lifetime tried to transfer ownership to the same instance.");
 
-            // Remove mutability
-            if(*this->m_mutator != nullptr && *this->m_mutator->m_mutator == this) delete *this->m_mutator;
+        // Remove mutability
+        if(this->is_mutator()) this->m_cell->mutator = 0U;
 
-            // Transfer ownership
-            this->m_owner = false;
-            lifetime.m_owner = true;
-        } else throw std::runtime_error("Lifetime tried to transfer ownership to a different Lifetime.");
+        // Transfer ownership
+        this->m_cell->owner = lifetime.m_id;
     }
 
     // Move
-    auto move() -> Lifetime<T>
+    constexpr auto move() -> ConstexprLifetime<T>
     {
-        assert(this->m_T != nullptr);
-        assert(this->m_owner != nullptr);
-        assert(this->m_refs != nullptr);
-        assert(this->m_mutator != nullptr);
+        check(this->is_owner(), lifetime_violation::move_without_ownership, "Lifetime tried to transfer ownership without maintaining object ownership.");
+        return ConstexprLifetime<T>(this->m_cell, true, false);
+    }
+
+private:
+    // The value and its shared state, in one allocation
+    // Handles are numbered rather than compared by address: GCC's constant evaluator does not
+    // keep `this` of a handle returned by value stable.
+    struct cell {
+        T value;
+        std::size_t owner;
+        std::size_t mutator;
+        std::size_t count;
+        std::size_t next_id;
+    };
+
+    constexpr ConstexprLifetime(cell* shared, bool take_ownership, bool take_mutability) noexcept : m_cell(shared), m_id(shared->next_id++)
+    {
+        ++this->m_cell->count;
+        if(take_ownership) this->m_cell->owner = this->m_id;
+        if(take_mutability && this->m_cell->mutator == 0U) this->m_cell->mutator = this->m_id;
+    }
 
-        if(this != *this->m_owner) throw std::runtime_error("Lifetime tried to transfer ownership without maintaining object ownership.");
-        return Lifetime<T>(this->m_T, this->m_owner, this->m_mutator, this->m_mutex, this->m_refs, true, false);
+    // Reports a broken rule (holds is false). During constant evaluation that reads a variable
+    // that is not usable in constant expressions, so the violation fails to compile; at
+    // runtime it goes to lifetime_detail::violate like any Lifetime violation.
+    constexpr auto static check(bool holds, lifetime_violation kind, const char* what) -> void
+    {
+        if(holds) return;
+        if(std::is_constant_evaluated())
+        {
+            if(lifetime_detail::violation_in_constant_expression) return;
+        }
+        else lifetime_detail::violate(kind, what);
     }
 
-    class LifetimeMutator {
+    cell* m_cell = nullptr;
+    std::size_t m_id = 0U;
+};
+#endif
+
+// Typestate mode: the borrow state is part of the type, so misuse fails to compile
+// Owned<T> is the only handle that can mutate without a mutable borrow, give up the value or
+// lend it out; Borrowed<T> is a read-only copyable view and MutBorrowed<T> a move-only
+// writable one. Each is a single pointer with no checks or shared cells. What types cannot
+// express (a borrow outliving its owner, overlapping shared and mutable borrows) is left to
+// Lifetime<T>, which an Owned<T> converts into with into_lifetime().
+namespace lifetime_static {
+
+    template<class T>
+    class Borrowed {
     public:
-        friend class Lifetime;
+        explicit Borrowed(const T* value) noexcept : m_T(Borrowed::hold(value)) {}
 
-        LifetimeMutator(Lifetime* mutator, LifetimeMutator** mutator_access)
+        // Get the value
+        auto get() const noexcept -> const T&
         {
-            this->m_mutator = mutator;
-            this->m_mutatorAccess = mutator_access;
-            *this->m_mutatorAccess = this;
+            if constexpr(by_value) return this->m_T;
+            else return *this->m_T;
         }
 
-        ~LifetimeMutator()
+        // Borrow again (shared borrows can be copied freely)
+        auto borrow() const noexcept -> Borrowed<T>
         {
-            this->m_mutator = nullptr;
-            *this->m_mutatorAccess = nullptr;
+            return *this;
         }
-    
-    protected:
-        Lifetime* m_mutator = nullptr;
-        LifetimeMutator** m_mutatorAccess = nullptr;
+
+    private:
+        // A value that cannot change is borrowed by copying it (see lifetime_traits)
+        constexpr static bool by_value = lifetime_traits<T>::copy_borrows;
+        using held_type = std::conditional_t<by_value, T, const T*>;
+
+        auto static hold(const T* value) noexcept -> held_type
+        {
+            if constexpr(by_value) return *value;
+            else return value;
+        }
+
+        held_type m_T;
     };
 
-    protected:
-    mutable T* m_T = nullptr;
-    mutable Lifetime** m_owner = nullptr;
-    mutable std::mutex* m_mutex;
-    mutable LifetimeMutator** m_mutator;
-    mutable std::set<Lifetime*>* m_refs;
+    template<class T>
+    class MutBorrowed {
+    public:
+        explicit MutBorrowed(T* value) noexcept : m_T(value) {}
 
-};
+        // Only one writable handle at a time: moving it hands the access on
+        MutBorrowed(MutBorrowed const&) = delete;
+        void operator=(MutBorrowed const&) = delete;
+        MutBorrowed(MutBorrowed&&) noexcept = default;
+        auto operator=(MutBorrowed&&) noexcept -> MutBorrowed& = default;
+
+        // Get the value
+        auto get() const noexcept -> const T&
+        {
+            return *this->m_T;
+        }
+
+        // Get mutable
+        auto get_mutable() noexcept -> T&
+        {
+            return *this->m_T;
+        }
+
+        // Set new value
+        auto set(T&& value) -> void
+        {
+            *this->m_T = std::move(value);
+        }
+
+        // Shared borrow for the duration of this mutable one
+        auto borrow() const& noexcept -> Borrowed<T>
+        {
+            return Borrowed<T>(this->m_T);
+        }
+
+    private:
+        T* m_T;
+    };
+
+    template<class T>
+    class Owned {
+    public:
+        // Create a new owner
+        auto static from(T&& value) -> Owned<T>
+        {
+            return Owned<T>(new T{std::move(value)});
+        }
+
+        Owned(Owned const&) = delete;
+        void operator=(Owned const&) = delete;
+
+        Owned(Owned&& other) noexcept : m_T(std::exchange(other.m_T, nullptr)) {}
+
+        auto operator=(Owned&& other) noexcept -> Owned&
+        {
+            if(this != &other)
+            {
+                delete this->m_T;
+                this->m_T = std::exchange(other.m_T, nullptr);
+            }
+            return *this;
+        }
+
+        ~Owned()
+        {
+            delete this->m_T;
+        }
+
+        // Get the value
+        auto get() const noexcept -> const T&
+        {
+            assert(this->m_T != nullptr);
+            return *this->m_T;
+        }
+
+        // Get mutable (the owner needs no mutable borrow)
+        auto get_mutable() noexcept -> T& LIFETIME_REQUIRES(!lifetime_traits<T>::is_immutable)
+        {
+            assert(this->m_T != nullptr);
+            return *this->m_T;
+        }
+
+        // Set new value
+        auto set(T&& value) -> void LIFETIME_REQUIRES(!lifetime_traits<T>::is_immutable)
+        {
+            assert(this->m_T != nullptr);
+            *this->m_T = std::move(value);
+        }
+
+        // Borrow (not from a temporary owner, which would dangle immediately)
+        auto borrow() const& noexcept -> Borrowed<T>
+        {
+            assert(this->m_T != nullptr);
+            return Borrowed<T>(this->m_T);
+        }
+
+        auto borrow() const&& -> Borrowed<T> = delete;
+
+        // Borrow mutable (needs a non-const owner)
+        auto borrow_mutable() & noexcept -> MutBorrowed<T> LIFETIME_REQUIRES(!lifetime_traits<T>::is_immutable)
+        {
+            assert(this->m_T != nullptr);
+            return MutBorrowed<T>(this->m_T);
+        }
+
+        auto borrow_mutable() && -> MutBorrowed<T> LIFETIME_REQUIRES(!lifetime_traits<T>::is_immutable) = delete;
+
+        // Clone
+        auto clone() const -> Owned<T>
+        {
+            assert(this->m_T != nullptr);
+            return Owned<T>(new T{*this->m_T});
+        }
+
+        // Move (ownership transfer consumes the owner: `std::move(owned).move()`)
+        auto move() && noexcept -> Owned<T>
+        {
+            return Owned<T>(std::move(*this));
+        }
+
+        // Runtime-checked handle for ownership that cannot be tracked statically
+        auto into_lifetime(lifetime_site site = lifetime_site()) && noexcept -> Lifetime<T>
+        {
+            assert(this->m_T != nullptr);
+            return Lifetime<T>(std::exchange(this->m_T, nullptr), nullptr, nullptr, nullptr, nullptr, nullptr, false, false, site);
+        }
+
+    private:
+        explicit Owned(T* value) noexcept : m_T(value) {}
+
+        T* m_T;
+    };
+}
+
+#if defined(LIFETIME_RECORD)
+namespace lifetime_record {
+
+    struct replay_result {
+        std::uint64_t events = 0;
+        std::uint64_t replayed = 0;
+        // Events naming handles or objects that were never created in this stream
+        std::uint64_t skipped = 0;
+        std::uint64_t violations_recorded = 0;
+        std::uint64_t violations_raised = 0;
+        std::uint64_t elapsed_ns = 0;
+    };
+
+    // Re-executes a recorded stream on one thread, in time order
+    // The stream does not carry types, so every object is replayed as a default constructed T.
+    // Handle<T> is the implementation under test: anything with Lifetime's from / borrow /
+    // borrow_mutable / move / get / get_mutable / set interface (Lifetime itself by default,
+    // under whatever lifetime_checks level and sampling rate are in effect).
+    template<class T, template<class> class Handle = Lifetime>
+    class replayer {
+    public:
+        replayer() = default;
+
+        replayer(replayer const&) = delete;
+        void operator=(replayer const&) = delete;
+
+        // Borrows are released before owners so leftovers do not count as violations
+        ~replayer()
+        {
+#if !defined(LIFETIME_EXCEPTIONS)
+            const lifetime_checks::violation_handler previous = lifetime_checks::detail::handler_cell().exchange(&ignore);
+#endif
+            for(int pass = 0; pass < 2; ++pass)
+                for(auto it = this->m_handles.begin(); it != this->m_handles.end();)
+                {
+                    const bool is_owner = this->m_owners[it->second.object] == it->first;
+                    if(is_owner == (pass == 1))
+                    {
+#if defined(LIFETIME_EXCEPTIONS)
+                        try { delete it->second.handle; } catch(const std::runtime_error&) {}
+#else
+                        delete it->second.handle;
+#endif
+                        it = this->m_handles.erase(it);
+                    }
+                    else ++it;
+                }
+#if !defined(LIFETIME_EXCEPTIONS)
+            lifetime_checks::set_violation_handler(previous);
+#endif
+        }
+
+        // Without exceptions a violation cannot abort the operation, so the replay lets it go
+        // ahead (as with checking off) and counts it through last_violation()
+        auto run(const std::vector<event>& stream) -> replay_result
+        {
+            replay_result result;
+#if !defined(LIFETIME_EXCEPTIONS)
+            const lifetime_checks::violation_handler previous = lifetime_checks::detail::handler_cell().exchange(&ignore);
+#endif
+            const std::uint64_t begin = lifetime_detail::now_ns();
+            for(const event& e : stream)
+            {
+                ++result.events;
+                if(e.op == lifetime_op::violation)
+                {
+                    ++result.violations_recorded;
+                    continue;
+                }
+#if defined(LIFETIME_EXCEPTIONS)
+                try
+                {
+                    if(this->apply(e)) ++result.replayed;
+                    else ++result.skipped;
+                }
+                catch(const std::runtime_error&)
+                {
+                    ++result.replayed;
+                    ++result.violations_raised;
+                }
+#else
+                lifetime_checks::clear_last_violation();
+                if(this->apply(e)) ++result.replayed;
+                else ++result.skipped;
+                if(lifetime_checks::last_violation() != lifetime_violation::count) ++result.violations_raised;
+#endif
+            }
+            result.elapsed_ns = lifetime_detail::now_ns() - begin;
+#if !defined(LIFETIME_EXCEPTIONS)
+            lifetime_checks::set_violation_handler(previous);
+#endif
+            return result;
+        }
+
+    private:
+#if !defined(LIFETIME_EXCEPTIONS)
+        auto static ignore(lifetime_violation, const char*) -> void {}
+#endif
+
+        struct live_handle {
+            Handle<T>* handle = nullptr;
+            std::uint32_t object = 0;
+        };
+
+        // A live handle of the object to borrow from, preferring its owner
+        auto any_handle(std::uint32_t object) -> Handle<T>*
+        {
+            const auto owner = this->m_handles.find(this->m_owners[object]);
+            if(owner != this->m_handles.end()) return owner->second.handle;
+            for(auto& [id, live] : this->m_handles)
+                if(live.object == object) return live.handle;
+            return nullptr;
+        }
+
+        auto apply(const event& e) -> bool
+        {
+            const auto it = this->m_handles.find(e.handle);
+            switch(e.op)
+            {
+                case lifetime_op::create:
+                    this->m_handles[e.handle] = live_handle{new Handle<T>(Handle<T>::from(T{})), e.object};
+                    this->m_owners[e.object] = e.handle;
+                    return true;
+                case lifetime_op::borrow:
+                case lifetime_op::borrow_mutable:
+                case lifetime_op::move:
+                {
+                    Handle<T>* from = this->any_handle(e.object);
+                    if(from == nullptr) return false;
+                    Handle<T>* handle = e.op == lifetime_op::borrow ? new Handle<T>(from->borrow())
+                                      : e.op == lifetime_op::borrow_mutable ? new Handle<T>(from->borrow_mutable())
+                                      : new Handle<T>(from->move());
+                    this->m_handles[e.handle] = live_handle{handle, e.object};
+                    if(e.op == lifetime_op::move) this->m_owners[e.object] = e.handle;
+                    return true;
+                }
+                case lifetime_op::move_to:
+                {
+                    const auto from = this->m_handles.find(e.aux);
+                    if(it == this->m_handles.end() || from == this->m_handles.end()) return false;
+                    from->second.handle->move(*it->second.handle);
+                    this->m_owners[e.object] = e.handle;
+                    return true;
+                }
+                case lifetime_op::get:
+                    if(it == this->m_handles.end()) return false;
+                    static_cast<void>(it->second.handle->get());
+                    return true;
+                case lifetime_op::get_mutable:
+                    if(it == this->m_handles.end()) return false;
+                    static_cast<void>(it->second.handle->get_mutable());
+                    return true;
+                case lifetime_op::set:
+                    if(it == this->m_handles.end()) return false;
+                    it->second.handle->set(T{});
+                    return true;
+                case lifetime_op::release:
+                {
+                    if(it == this->m_handles.end()) return false;
+                    Handle<T>* handle = it->second.handle;
+                    this->m_handles.erase(it);
+                    delete handle;
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        std::map<std::uint32_t, live_handle> m_handles;
+        // Recorded owner handle of each object
+        std::map<std::uint32_t, std::uint32_t> m_owners;
+    };
+}
+#endif
+
+#if defined(LIFETIME_COMPILED_LIB)
+// Instantiated once in lifetime.cpp
+extern template class Lifetime<int>;
+extern template class Lifetime<unsigned int>;
+extern template class Lifetime<long>;
+extern template class Lifetime<unsigned long>;
+extern template class Lifetime<long long>;
+extern template class Lifetime<unsigned long long>;
+extern template class Lifetime<std::string>;
+extern template class Lifetime<std::vector<std::byte>>;
+#endif
 
 #endif
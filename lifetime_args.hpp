@@ -0,0 +1,138 @@
+/**
+ * @file lifetime_args.hpp
+ * @author Ty Qualters (contact@tyqualters.com)
+ * @brief Checked access to several Lifetime parameters of one function
+ * @version 0.1
+ * @date 2022-12-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#pragma once
+
+#ifndef CPP_LIFETIME_ARGS_H_
+#define CPP_LIFETIME_ARGS_H_
+
+#include "lifetime.hpp"
+
+#include <tuple>
+
+// Checked access to several Lifetime parameters of one function
+// Arguments are Lifetime<T>& (read) or lifetime_args::mut(handle) (written). Only handles of the
+// same T can share an object, so only those pairs with a writer among them are compared at
+// runtime; a written argument aliasing any other one is a violation. Each argument is checked
+// once, without taking a borrow.
+//
+//     lifetime_args::access args(src, lifetime_args::mut(dst));
+//     auto [in, out] = args.values(); // const T&, T&
+namespace lifetime_args {
+
+    // An argument the function writes through
+    template<class T> LIFETIME_REQUIRES(!Lifetime<T>::is_immutable)
+    struct mutable_arg {
+        Lifetime<T>& handle;
+    };
+
+    template<class T> LIFETIME_REQUIRES(!Lifetime<T>::is_immutable)
+    auto mut(Lifetime<T>& handle) noexcept -> mutable_arg<T>
+    {
+        return mutable_arg<T>{handle};
+    }
+
+    namespace detail {
+
+        template<class A>
+        struct arg;
+
+        template<class T>
+        struct arg<Lifetime<T>> {
+            using value_type = T;
+            using param = Lifetime<T>&;
+            using reference = const T&;
+            constexpr static bool is_mutable = false;
+
+            auto static handle(Lifetime<T>& a) noexcept -> Lifetime<T>&
+            {
+                return a;
+            }
+
+            auto static access(Lifetime<T>& a, const lifetime_site&) -> reference
+            {
+                return a.get();
+            }
+        };
+
+        template<class T>
+        struct arg<mutable_arg<T>> {
+            using value_type = T;
+            using param = mutable_arg<T>;
+            using reference = T&;
+            constexpr static bool is_mutable = true;
+
+            auto static handle(mutable_arg<T>& a) noexcept -> Lifetime<T>&
+            {
+                return a.handle;
+            }
+
+            auto static access(mutable_arg<T>& a, const lifetime_site& site) -> reference
+            {
+                return a.handle.get_mutable(site);
+            }
+        };
+
+        // Can the two refer to one object with at least one of them writing it?
+        template<class A, class B>
+        inline constexpr bool may_conflict = std::is_same_v<typename arg<A>::value_type, typename arg<B>::value_type> && (arg<A>::is_mutable || arg<B>::is_mutable);
+
+        template<class A, class B>
+        auto check_pair([[maybe_unused]] A& a, [[maybe_unused]] B& b, [[maybe_unused]] const lifetime_site& site) -> void
+        {
+            if constexpr(may_conflict<A, B>)
+            {
+                if(arg<A>::handle(a).shares_object(arg<B>::handle(b)))
+                {
+                    // Worded against the argument that writes
+                    auto& writer = arg<A>::is_mutable ? arg<A>::handle(a) : arg<B>::handle(b);
+                    lifetime_detail::violate(lifetime_violation::aliased_mutable_argument, lifetime_detail::handle_access::report(writer, "Lifetime passed as a mutable argument aliases another argument.", site));
+                }
+            }
+        }
+
+        // Every pair, each once
+        template<class A, class... Rest>
+        auto check_all(const lifetime_site& site, A& a, Rest&... rest) -> void
+        {
+            (check_pair(a, rest, site), ...);
+            if constexpr(sizeof...(Rest) > 1U) check_all(site, rest...);
+        }
+    }
+
+    template<class... Args>
+    class access {
+    public:
+        using values_type = std::tuple<typename detail::arg<Args>::reference...>;
+
+        access(typename detail::arg<Args>::param... args, lifetime_site site = lifetime_site()) : m_values(access::checked(site, args...)) {}
+
+        // References to the arguments' values, in order
+        auto values() const noexcept -> values_type
+        {
+            return this->m_values;
+        }
+
+    private:
+        auto static checked(const lifetime_site& site, Args&... args) -> values_type
+        {
+            if constexpr(sizeof...(Args) > 1U) detail::check_all(site, args...);
+            return values_type(detail::arg<Args>::access(args, site)...);
+        }
+
+        values_type m_values;
+    };
+
+    template<class... A>
+    access(A&&...) -> access<std::remove_cvref_t<A>...>;
+}
+
+#endif
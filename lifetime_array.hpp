@@ -0,0 +1,354 @@
+/**
+ * @file lifetime_array.hpp
+ * @author Ty Qualters (contact@tyqualters.com)
+ * @brief Runtime-sized arrays for lifetime.hpp: Lifetime<T[]> and LifetimeSlice
+ * @version 0.1
+ * @date 2022-12-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#pragma once
+
+#ifndef CPP_LIFETIME_ARRAY_H_
+#define CPP_LIFETIME_ARRAY_H_
+
+#include "lifetime.hpp"
+
+#include <memory>
+#include <new>
+#include <span>
+#include <initializer_list>
+
+namespace lifetime_detail {
+
+    // Elements of a Lifetime<T[]> and their count, in one allocation
+    template<class T>
+    class array_block {
+    public:
+        using value_type = std::remove_const_t<T>;
+
+        // count value-initialised elements
+        auto static create(std::size_t count) -> array_block*
+        {
+            array_block* block = array_block::allocate(count);
+            array_block::construct(block, [&](value_type* data) { std::uninitialized_value_construct_n(data, count); });
+            return block;
+        }
+
+        // Copies of count elements from first
+        auto static create(const value_type* first, std::size_t count) -> array_block*
+        {
+            array_block* block = array_block::allocate(count);
+            array_block::construct(block, [&](value_type* data) { std::uninitialized_copy_n(first, count, data); });
+            return block;
+        }
+
+        ~array_block()
+        {
+            std::destroy_n(this->data(), this->m_size);
+        }
+
+        auto static operator delete(void* memory) noexcept -> void
+        {
+            ::operator delete(memory, std::align_val_t{alignment});
+        }
+
+        array_block(const array_block&) = delete;
+        void operator=(const array_block&) = delete;
+
+        auto data() noexcept -> value_type*
+        {
+            return std::launder(reinterpret_cast<value_type*>(reinterpret_cast<unsigned char*>(this) + offset));
+        }
+
+        auto data() const noexcept -> const value_type*
+        {
+            return std::launder(reinterpret_cast<const value_type*>(reinterpret_cast<const unsigned char*>(this) + offset));
+        }
+
+        auto size() const noexcept -> std::size_t
+        {
+            return this->m_size;
+        }
+
+        // Bytes of the allocation: the count and the elements
+        auto bytes() const noexcept -> std::size_t
+        {
+            return offset + this->m_size * sizeof(value_type);
+        }
+
+    private:
+        constexpr static std::size_t alignment = alignof(value_type) > alignof(std::size_t) ? alignof(value_type) : alignof(std::size_t);
+        // Elements start after the count, aligned for value_type
+        constexpr static std::size_t offset = (sizeof(std::size_t) + alignof(value_type) - 1U) / alignof(value_type) * alignof(value_type);
+
+        explicit array_block(std::size_t count) noexcept : m_size(count) {}
+
+        auto static allocate(std::size_t count) -> array_block*
+        {
+            if(count > (static_cast<std::size_t>(-1) - offset) / sizeof(value_type))
+            {
+#if defined(LIFETIME_EXCEPTIONS)
+                throw std::bad_array_new_length();
+#else
+                std::abort();
+#endif
+            }
+            void* memory = ::operator new(offset + count * sizeof(value_type), std::align_val_t{alignment});
+            return ::new(memory) array_block(count);
+        }
+
+        // Runs init over the uninitialised elements, freeing the block if it throws
+        template<class Init>
+        auto static construct(array_block* block, Init&& init) -> void
+        {
+#if defined(LIFETIME_EXCEPTIONS)
+            try
+            {
+#endif
+                init(block->data());
+#if defined(LIFETIME_EXCEPTIONS)
+            }
+            catch(...)
+            {
+                array_block::operator delete(block);
+                throw;
+            }
+#endif
+        }
+
+        std::size_t m_size;
+    };
+
+    // Reported as T[], charged for the whole block
+    template<class T>
+    struct value_report<array_block<T>> {
+        using type = T[];
+
+        auto static size(const array_block<T>& block) noexcept -> std::size_t
+        {
+            return block.bytes();
+        }
+    };
+}
+
+// A Lifetime<T[]> is as writable as its elements
+template<class T>
+struct lifetime_traits<lifetime_detail::array_block<T>> {
+    constexpr static bool is_immutable = std::is_const_v<T>;
+    constexpr static bool copy_borrows = false;
+};
+
+// Runtime-sized array: the elements live in one allocation and every handle follows Lifetime's
+// ownership and borrowing rules (each is a Lifetime of the element block). get() and
+// get_mutable() check once and return a std::span; borrow_slice() and borrow_slice_mutable()
+// take a borrow for part of the array, after which element access is unchecked.
+template<class T>
+class Lifetime<T[]> {
+public:
+    using value_type = std::remove_const_t<T>;
+    using block_lifetime = Lifetime<lifetime_detail::array_block<T>>;
+
+    constexpr static bool is_immutable = block_lifetime::is_immutable;
+
+    // Disable copying
+    Lifetime(Lifetime const&) = delete;
+    void operator=(Lifetime const &x) = delete;
+
+    // Create count value-initialised elements
+    auto static make(std::size_t count, lifetime_site site = lifetime_site()) -> Lifetime
+    {
+        return Lifetime(lifetime_detail::array_block<T>::create(count), site);
+    }
+
+    // Create from a list of values
+    auto static from(std::initializer_list<value_type> values, lifetime_site site = lifetime_site()) -> Lifetime
+    {
+        return Lifetime(lifetime_detail::array_block<T>::create(values.begin(), values.size()), site);
+    }
+
+    // Create from a copy of a range of values
+    auto static from(std::span<const value_type> values, lifetime_site site = lifetime_site()) -> Lifetime
+    {
+        return Lifetime(lifetime_detail::array_block<T>::create(values.data(), values.size()), site);
+    }
+
+    // Number of elements
+    auto size() noexcept -> std::size_t
+    {
+        return this->m_block.get().size();
+    }
+
+    // Get mutable
+    auto get_mutable(lifetime_site site = lifetime_site()) -> std::span<value_type> LIFETIME_REQUIRES(!is_immutable)
+    {
+        lifetime_detail::array_block<T>& block = this->m_block.get_mutable(site);
+        return std::span<value_type>(block.data(), block.size());
+    }
+
+    // Get the values
+    auto get() noexcept -> std::span<const value_type>
+    {
+        const lifetime_detail::array_block<T>& block = this->m_block.get();
+        return std::span<const value_type>(block.data(), block.size());
+    }
+
+    // Borrow
+    auto borrow(lifetime_site site = lifetime_site()) noexcept -> Lifetime
+    {
+        return Lifetime(std::in_place, [&] { return this->m_block.borrow(site); });
+    }
+
+    // Borrow mutable
+    auto borrow_mutable(lifetime_site site = lifetime_site()) -> Lifetime LIFETIME_REQUIRES(!is_immutable)
+    {
+        return Lifetime(std::in_place, [&] { return this->m_block.borrow_mutable(site); });
+    }
+
+    // Borrow [offset, offset + count)
+    auto borrow_slice(std::size_t offset, std::size_t count, lifetime_site site = lifetime_site()) -> LifetimeSlice<const value_type, T>
+    {
+        return LifetimeSlice<const value_type, T>(*this, offset, count, site);
+    }
+
+    // Borrow [offset, offset + count) mutable
+    auto borrow_slice_mutable(std::size_t offset, std::size_t count, lifetime_site site = lifetime_site()) -> LifetimeSlice<value_type, T> LIFETIME_REQUIRES(!is_immutable)
+    {
+        return LifetimeSlice<value_type, T>(*this, offset, count, site);
+    }
+
+    // Clone
+    auto clone(lifetime_site site = lifetime_site()) -> Lifetime
+    {
+        return Lifetime<T[]>::from(this->get(), site);
+    }
+
+    // Get mutability
+    auto is_mutator() noexcept -> bool
+    {
+        return this->m_block.is_mutator();
+    }
+
+    // Get ownership
+    auto is_owner() noexcept -> bool
+    {
+        return this->m_block.is_owner();
+    }
+
+    // Handle of the same array?
+    auto shares_object(const Lifetime& other) const noexcept -> bool
+    {
+        return this->m_block.shares_object(other.m_block);
+    }
+
+    // Move to
+    auto move(Lifetime& lifetime, lifetime_site site = lifetime_site()) -> void
+    {
+        this->m_block.move(lifetime.m_block, site);
+    }
+
+    // Move
+    auto move(lifetime_site site = lifetime_site()) -> Lifetime
+    {
+        return Lifetime(std::in_place, [&] { return this->m_block.move(site); });
+    }
+
+private:
+    Lifetime(lifetime_detail::array_block<T>* block, lifetime_site site) noexcept : m_block(block, nullptr, nullptr, nullptr, nullptr, nullptr, false, false, site) {}
+
+    // Handles are not movable, so a new one is built in place from make()
+    template<class Make>
+    Lifetime(std::in_place_t, Make&& make) : m_block(make()) {}
+
+    friend struct lifetime_detail::handle_access;
+
+    block_lifetime m_block;
+};
+
+// Borrowed part of a Lifetime<A[]>, usable like a std::span<T>
+// Holds a borrow (mutable for a non-const T) for as long as it lives; bounds are checked once
+// when it is taken and element access is unchecked. The borrow is a LifetimeRange's, so while
+// the slice lives any get_mutable() on the array is a modified_during_range violation, and
+// begin() fails if the array was accessed mutable since the slice was taken.
+template<class T, class A>
+class LifetimeSlice {
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using iterator = T*;
+
+    LifetimeSlice(Lifetime<A[]>& source, std::size_t offset, std::size_t count, lifetime_site site = lifetime_site()) : m_borrow(source, site)
+    {
+        const std::span<T> all(this->m_borrow.value().data(), this->m_borrow.value().size());
+        if(offset > all.size() || count > all.size() - offset)
+        {
+            lifetime_detail::violate(lifetime_violation::slice_out_of_range, lifetime_detail::handle_access::report(source, "Lifetime slice out of range.", site));
+            // Only reached with checking off or a returning handler: keep what is in range
+            offset = offset > all.size() ? all.size() : offset;
+            count = count > all.size() - offset ? all.size() - offset : count;
+        }
+        this->m_data = all.data() + offset;
+        this->m_size = count;
+    }
+
+    // Disable copying
+    LifetimeSlice(LifetimeSlice const&) = delete;
+    void operator=(LifetimeSlice const &x) = delete;
+
+    auto operator[](std::size_t index) const noexcept -> T&
+    {
+        assert(index < this->m_size);
+        return this->m_data[index];
+    }
+
+    auto data() const noexcept -> T*
+    {
+        return this->m_data;
+    }
+
+    auto size() const noexcept -> std::size_t
+    {
+        return this->m_size;
+    }
+
+    auto empty() const noexcept -> bool
+    {
+        return this->m_size == 0U;
+    }
+
+    auto begin() const -> iterator
+    {
+        this->m_borrow.check("Lifetime slice used after its array was accessed mutable.");
+        return this->m_data;
+    }
+
+    auto end() const noexcept -> iterator
+    {
+        return this->m_data + this->m_size;
+    }
+
+    auto span() const noexcept -> std::span<T>
+    {
+        return std::span<T>(this->m_data, this->m_size);
+    }
+
+    operator std::span<T>() const noexcept
+    {
+        return this->span();
+    }
+
+    // No mutable access to the array since the slice was taken?
+    auto valid() const noexcept -> bool
+    {
+        return this->m_borrow.valid();
+    }
+
+private:
+    lifetime_detail::range_borrow<Lifetime<A[]>, !std::is_const_v<T>> m_borrow;
+    T* m_data = nullptr;
+    std::size_t m_size = 0U;
+};
+
+#endif
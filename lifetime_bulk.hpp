@@ -0,0 +1,152 @@
+/**
+ * @file lifetime_bulk.hpp
+ * @author Ty Qualters (contact@tyqualters.com)
+ * @brief Bulk algorithms over the elements of a Lifetime of contiguous data
+ * @version 0.1
+ * @date 2022-12-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#pragma once
+
+#ifndef CPP_LIFETIME_BULK_H_
+#define CPP_LIFETIME_BULK_H_
+
+#include "lifetime.hpp"
+#include "lifetime_array.hpp"
+
+#include <iterator>
+#include <memory>
+
+// Algorithms over the elements of a Lifetime of contiguous data (Lifetime<T[]> or a Lifetime of a
+// contiguous container such as std::vector)
+// Each takes one borrow for the whole batch (a LifetimeSlice or LifetimeRange, so mutable
+// access from elsewhere is reported while it runs) and then loops over plain pointers, which
+// the compiler can vectorise when the callable inlines.
+namespace lifetime_bulk {
+
+    namespace detail {
+
+        // One borrow covering every element
+        template<class C>
+        auto borrow_all(Lifetime<C>& handle, const lifetime_site& site) -> LifetimeRange<const C, C>
+        {
+            return handle.range(site);
+        }
+
+        template<class T>
+        auto borrow_all(Lifetime<T[]>& handle, const lifetime_site& site) -> LifetimeSlice<const std::remove_const_t<T>, T>
+        {
+            return handle.borrow_slice(0U, handle.size(), site);
+        }
+
+        template<class C>
+        auto borrow_all_mutable(Lifetime<C>& handle, const lifetime_site& site) -> LifetimeRange<C, C>
+        {
+            return handle.range_mutable(site);
+        }
+
+        template<class T>
+        auto borrow_all_mutable(Lifetime<T[]>& handle, const lifetime_site& site) -> LifetimeSlice<std::remove_const_t<T>, T>
+        {
+            return handle.borrow_slice_mutable(0U, handle.size(), site);
+        }
+
+        // First element of a batch (begin() runs the batch's one validity check)
+        template<class Batch>
+        auto first_of(const Batch& batch)
+        {
+            static_assert(std::contiguous_iterator<decltype(batch.begin())>, "lifetime_bulk needs contiguous data");
+            return std::to_address(batch.begin());
+        }
+
+        template<class In, class Out, class F>
+        auto transform_kernel(const In* LIFETIME_RESTRICT in, Out* LIFETIME_RESTRICT out, std::size_t count, F& f) -> void
+        {
+            for(std::size_t i = 0U; i < count; ++i) out[i] = f(in[i]);
+        }
+
+        // Independent partial results, so the loop vectorises without reassociation flags
+        inline constexpr std::size_t reduce_lanes = 8U;
+    }
+
+    // f(element) for every element, under one shared borrow
+    template<class C, class F>
+    auto for_each(Lifetime<C>& handle, F f, lifetime_site site = lifetime_site()) -> F
+    {
+        const auto batch = detail::borrow_all(handle, site);
+        const auto* const first = detail::first_of(batch);
+        const std::size_t count = static_cast<std::size_t>(std::to_address(batch.end()) - first);
+        for(std::size_t i = 0U; i < count; ++i) f(first[i]);
+        return f;
+    }
+
+    // element = f(element) for every element, under one mutable borrow
+    template<class C, class F>
+    auto transform(Lifetime<C>& handle, F f, lifetime_site site = lifetime_site()) -> void
+    {
+        const auto batch = detail::borrow_all_mutable(handle, site);
+        auto* const first = detail::first_of(batch);
+        const std::size_t count = static_cast<std::size_t>(std::to_address(batch.end()) - first);
+        for(std::size_t i = 0U; i < count; ++i) first[i] = f(first[i]);
+    }
+
+    // out[i] = f(in[i]), under a shared borrow of in and a mutable one of out
+    // out must be another object at least as long as in.
+    template<class C, class D, class F>
+    auto transform(Lifetime<C>& in, Lifetime<D>& out, F f, lifetime_site site = lifetime_site()) -> void
+    {
+        if constexpr(std::is_same_v<C, D>)
+        {
+            if(in.shares_object(out))
+                lifetime_detail::violate(lifetime_violation::aliased_mutable_argument, lifetime_detail::handle_access::report(out, "Bulk transform writes to its own input (use the in-place transform).", site));
+        }
+        const auto source = detail::borrow_all(in, site);
+        const auto target = detail::borrow_all_mutable(out, site);
+        const auto* const first = detail::first_of(source);
+        auto* const result = detail::first_of(target);
+        std::size_t count = static_cast<std::size_t>(std::to_address(source.end()) - first);
+        const std::size_t room = static_cast<std::size_t>(std::to_address(target.end()) - result);
+        if(room < count)
+        {
+            lifetime_detail::violate(lifetime_violation::slice_out_of_range, lifetime_detail::handle_access::report(out, "Bulk transform output is shorter than its input.", site));
+            // Only reached with checking off or a returning handler
+            count = room;
+        }
+        detail::transform_kernel(first, result, count, f);
+    }
+
+    // Combination of init and every element with op, under one shared borrow
+    // As with std::reduce, op must be associative and commutative: elements are combined in
+    // detail::reduce_lanes interleaved partial results.
+    template<class C, class R, class Op>
+    auto reduce(Lifetime<C>& handle, R init, Op op, lifetime_site site = lifetime_site()) -> R
+    {
+        constexpr std::size_t lanes = detail::reduce_lanes;
+        const auto batch = detail::borrow_all(handle, site);
+        const auto* const first = detail::first_of(batch);
+        const std::size_t count = static_cast<std::size_t>(std::to_address(batch.end()) - first);
+        std::size_t i = 0U;
+        if(count >= lanes)
+        {
+            R partial[lanes];
+            for(std::size_t k = 0U; k < lanes; ++k) partial[k] = static_cast<R>(first[k]);
+            for(i = lanes; i + lanes <= count; i += lanes)
+                for(std::size_t k = 0U; k < lanes; ++k) partial[k] = op(partial[k], first[i + k]);
+            for(std::size_t k = 0U; k < lanes; ++k) init = op(init, partial[k]);
+        }
+        for(; i < count; ++i) init = op(init, first[i]);
+        return init;
+    }
+
+    // Sum of init and every element
+    template<class C, class R>
+    auto reduce(Lifetime<C>& handle, R init, lifetime_site site = lifetime_site()) -> R
+    {
+        return lifetime_bulk::reduce(handle, init, [](const R& a, const auto& b) -> R { return a + b; }, site);
+    }
+}
+
+#endif
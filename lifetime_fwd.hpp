@@ -0,0 +1,53 @@
+/**
+ * @file lifetime_fwd.hpp
+ * @author Ty Qualters (contact@tyqualters.com)
+ * @brief Forward declarations of lifetime.hpp, for headers that only name its types
+ * @version 0.1
+ * @date 2022-12-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#pragma once
+
+#ifndef CPP_LIFETIME_FWD_H_
+#define CPP_LIFETIME_FWD_H_
+
+// Enough to declare functions taking or returning Lifetime<T>& / Lifetime<T>* and to name the
+// option enums; include lifetime.hpp where the handles are created or used.
+
+template<class T>
+class Lifetime;
+
+template<class T, class A>
+class LifetimeSlice;
+
+template<class T, class A>
+class LifetimeRange;
+
+template<class T>
+class ConstexprLifetime;
+
+template<class T>
+struct lifetime_traits;
+
+struct lifetime_site;
+
+enum class lifetime_violation : unsigned;
+enum class lifetime_op : unsigned char;
+enum class lifetime_check_level : int;
+
+namespace lifetime_static {
+
+    template<class T>
+    class Owned;
+
+    template<class T>
+    class Borrowed;
+
+    template<class T>
+    class MutBorrowed;
+}
+
+#endif
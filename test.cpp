@@ -0,0 +1,335 @@
+/**
+ * Checks for the violation kinds, check levels, slices, checked ranges, lifetime_args and the
+ * bulk algorithms, plus sampled checks and record / replay when built with those options.
+ * Needs exceptions (violations are caught from the default handler). Build with any
+ * LIFETIME_* options, e.g.:
+ *   g++ -std=c++20 -DLIFETIME_RECORD -DLIFETIME_SAMPLED_CHECKS test.cpp -o test && ./test
+ */
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "lifetime.hpp"
+#include "lifetime_array.hpp"
+#include "lifetime_args.hpp"
+#include "lifetime_bulk.hpp"
+#if defined(LIFETIME_RECORD)
+#include <sstream>
+#endif
+
+namespace {
+
+    int failures = 0;
+
+    auto check(bool ok, const char* what, int line) -> void
+    {
+        if(ok) return;
+        std::printf("FAIL (line %d): %s\n", line, what);
+        ++failures;
+    }
+
+    #define CHECK(...) check((__VA_ARGS__), #__VA_ARGS__, __LINE__)
+
+    // Message of the last violation
+    std::string last_what;
+
+    // Does f() fail with a violation of kind (through the default, throwing handler)?
+    template<class F>
+    auto raises(lifetime_violation kind, F f) -> bool
+    {
+        lifetime_checks::clear_last_violation();
+        try
+        {
+            f();
+        }
+        catch(const std::runtime_error& e)
+        {
+            last_what = e.what();
+            return lifetime_checks::last_violation() == kind;
+        }
+        return false;
+    }
+
+    // Violations seen by the returning handler
+    int returned = 0;
+
+    // Lets the operation go ahead, as with checking off
+    auto keep_going(lifetime_violation, const char* what) -> void
+    {
+        ++returned;
+        last_what = what;
+    }
+
+    // Does f() report exactly one violation of kind and then carry on?
+    template<class F>
+    auto reports(lifetime_violation kind, F f) -> bool
+    {
+        lifetime_checks::set_violation_handler(&keep_going);
+        lifetime_checks::clear_last_violation();
+        returned = 0;
+        f();
+        lifetime_checks::set_violation_handler(nullptr);
+        return returned == 1 && lifetime_checks::last_violation() == kind;
+    }
+
+    auto ownership() -> void
+    {
+        auto a = Lifetime<int>::from(1);
+        {
+            auto b = a.borrow();
+            CHECK(b.get() == 1);
+            CHECK(raises(lifetime_violation::mutable_without_ownership, [&] { b.get_mutable(); }));
+            CHECK(raises(lifetime_violation::write_without_ownership, [&] { b.set(2); }));
+            CHECK(raises(lifetime_violation::move_without_ownership, [&] { auto c = b.move(); }));
+        }
+        {
+            auto m = a.borrow_mutable();
+            CHECK(raises(lifetime_violation::mutable_borrow_exists, [&] { auto m2 = a.borrow_mutable(); }));
+        }
+        CHECK(raises(lifetime_violation::move_to_self, [&] { a.move(a); }));
+        auto other = Lifetime<int>::from(2);
+        CHECK(raises(lifetime_violation::move_to_foreign, [&] { a.move(other); }));
+        CHECK(a.is_owner() && other.is_owner());
+        {
+            // Ownership moves to b and back
+            auto b = a.move();
+            CHECK(b.is_owner() && !a.is_owner());
+            b.move(a);
+            CHECK(a.is_owner());
+        }
+        {
+            auto m = a.borrow_mutable();
+            m.set(3);
+        }
+        CHECK(a.get() == 3);
+        CHECK(raises(lifetime_violation::owner_freed_with_references, [] {
+            auto* owner = new Lifetime<int>(Lifetime<int>::from(1));
+            auto b = owner->borrow();
+            delete owner;
+        }));
+    }
+
+    auto levels() -> void
+    {
+        auto a = Lifetime<int>::from(1);
+        auto b = a.borrow();
+
+        lifetime_checks::set_level(lifetime_check_level::off);
+        CHECK(!raises(lifetime_violation::write_without_ownership, [&] { b.set(2); }));
+        CHECK(lifetime_checks::last_violation() == lifetime_violation::count);
+
+        // Counters only: the bare message, without sites or holders
+        lifetime_checks::set_level(lifetime_check_level::counters);
+        CHECK(raises(lifetime_violation::write_without_ownership, [&] { b.set(2); }));
+        CHECK(last_what == "Lifetime tried to write a new value without maintaining object ownership or mutability.");
+
+        CHECK(lifetime_checks::set_level("full") && lifetime_checks::level() == lifetime_check_level::full);
+        CHECK(!lifetime_checks::set_level("verbose") && lifetime_checks::level() == lifetime_check_level::full);
+        CHECK(raises(lifetime_violation::write_without_ownership, [&] { b.set(2); }));
+        CHECK(last_what.rfind("Lifetime tried to write a new value", 0) == 0);
+
+        // A returning handler lets the write go ahead
+        CHECK(reports(lifetime_violation::write_without_ownership, [&] { b.set(4); }));
+        CHECK(a.get() == 4);
+    }
+
+    auto ranges() -> void
+    {
+        auto v = Lifetime<std::vector<int>>::from(std::vector<int>{1, 2, 3});
+        {
+            auto r = v.range();
+            int sum = 0;
+            for(int x : r) sum += x;
+            CHECK(sum == 6 && r.valid());
+            CHECK(raises(lifetime_violation::modified_during_range, [&] { v.get_mutable(); }));
+            CHECK(reports(lifetime_violation::modified_during_range, [&] { v.set(std::vector<int>{1, 2, 3}); }));
+            CHECK(!r.valid());
+            CHECK(raises(lifetime_violation::modified_during_range, [&] { static_cast<void>(r.begin()); }));
+        }
+        for(int& x : v.range_mutable()) x *= 2;
+        CHECK(v.get()[2] == 6);
+        v.get_mutable().push_back(4);
+        CHECK(v.get().size() == 4);
+    }
+
+    auto slices() -> void
+    {
+        auto a = Lifetime<int[]>::from({1, 2, 3, 4, 5});
+        {
+            auto s = a.borrow_slice(1, 3);
+            CHECK(s.size() == 3 && s[0] == 2 && s[2] == 4);
+            CHECK(raises(lifetime_violation::modified_during_range, [&] { a.get_mutable(); }));
+            CHECK(raises(lifetime_violation::modified_during_range, [&] { auto w = a.borrow_slice_mutable(0, 1); }));
+        }
+        {
+            auto s = a.borrow_slice_mutable(3, 2);
+            s[1] = 50;
+            CHECK(raises(lifetime_violation::mutable_borrow_exists, [&] { auto w = a.borrow_slice_mutable(0, 1); }));
+        }
+        CHECK(a.get()[4] == 50);
+        CHECK(raises(lifetime_violation::slice_out_of_range, [&] { auto s = a.borrow_slice(4, 2); }));
+        CHECK(raises(lifetime_violation::slice_out_of_range, [&] { auto s = a.borrow_slice(6, 0); }));
+        // A returning handler gets what is in range
+        CHECK(reports(lifetime_violation::slice_out_of_range, [&] {
+            auto s = a.borrow_slice(4, 3);
+            CHECK(s.size() == 1 && s[0] == 50);
+        }));
+        CHECK(reports(lifetime_violation::slice_out_of_range, [&] { CHECK(a.borrow_slice(9, 1).empty()); }));
+        auto empty = a.borrow_slice(5, 0);
+        CHECK(empty.empty());
+    }
+
+    auto axpy(double k, Lifetime<std::vector<double>>& x, Lifetime<std::vector<double>>& y) -> void
+    {
+        lifetime_args::access args(x, lifetime_args::mut(y));
+        auto [xs, ys] = args.values();
+        for(std::size_t i = 0; i < ys.size(); ++i) ys[i] += k * xs[i];
+    }
+
+    auto args() -> void
+    {
+        using vector = std::vector<double>;
+        auto x = Lifetime<vector>::from(vector{1, 2, 3});
+        auto y = Lifetime<vector>::from(vector{1, 1, 1});
+        axpy(2.0, x, y);
+        CHECK(y.get()[2] == 7.0);
+        CHECK(raises(lifetime_violation::aliased_mutable_argument, [&] { axpy(1.0, x, x); }));
+        {
+            auto xb = x.borrow();
+            CHECK(raises(lifetime_violation::aliased_mutable_argument, [&] { axpy(1.0, xb, x); }));
+        }
+        CHECK(x.get()[2] == 3.0);
+        // Shared arguments may alias, and different types never do
+        lifetime_args::access shared(x, x);
+        CHECK(std::get<0>(shared.values()).size() == 3);
+        auto n = Lifetime<int>::from(0);
+        lifetime_args::access mixed(lifetime_args::mut(n), x);
+        std::get<0>(mixed.values()) = 1;
+        CHECK(n.get() == 1);
+    }
+
+    auto bulk() -> void
+    {
+        auto a = Lifetime<int[]>::from({1, 2, 3, 4});
+        auto b = Lifetime<int[]>::make(4);
+        int sum = 0;
+        lifetime_bulk::for_each(a, [&sum](int x) { sum += x; });
+        CHECK(sum == 10);
+        lifetime_bulk::transform(a, [](int x) { return x * 2; });
+        CHECK(a.get()[3] == 8);
+        lifetime_bulk::transform(a, b, [](int x) { return x + 1; });
+        CHECK(b.get()[0] == 3 && b.get()[3] == 9);
+        CHECK(lifetime_bulk::reduce(a, 0) == 20);
+        CHECK(lifetime_bulk::reduce(b, 1, [](int l, int r) { return l * r; }) == 3 * 5 * 7 * 9);
+        auto v = Lifetime<std::vector<long>>::from(std::vector<long>(100, 2));
+        CHECK(lifetime_bulk::reduce(v, 0L) == 200L);
+        {
+            // Through the handle's own mutable borrow
+            auto m = a.borrow_mutable();
+            lifetime_bulk::transform(m, [](int x) { return -x; });
+        }
+        CHECK(a.get()[0] == -2);
+
+        CHECK(raises(lifetime_violation::aliased_mutable_argument, [&] { lifetime_bulk::transform(a, a, [](int x) { return x; }); }));
+        auto small = Lifetime<int[]>::make(2);
+        CHECK(raises(lifetime_violation::slice_out_of_range, [&] { lifetime_bulk::transform(a, small, [](int x) { return x; }); }));
+        // A returning handler gets the part that fits
+        CHECK(reports(lifetime_violation::slice_out_of_range, [&] { lifetime_bulk::transform(a, small, [](int x) { return x; }); }));
+        CHECK(small.get()[1] == -4);
+        {
+            auto s = a.borrow_slice(0, 1);
+            CHECK(raises(lifetime_violation::modified_during_range, [&] { lifetime_bulk::transform(a, [](int x) { return x; }); }));
+        }
+    }
+
+#if defined(LIFETIME_SAMPLED_CHECKS)
+    auto sampled() -> void
+    {
+        // Untracked Lifetimes still check ownership and mutability
+        for(const std::uint32_t rate : {0U, 1U, 3U})
+        {
+            lifetime_sampling::set_rate(rate);
+            for(int i = 0; i < 3; ++i)
+            {
+                auto a = Lifetime<int>::from(1);
+                auto b = a.borrow();
+                CHECK(raises(lifetime_violation::write_without_ownership, [&] { b.set(2); }));
+                auto m = a.borrow_mutable();
+                CHECK(raises(lifetime_violation::mutable_borrow_exists, [&] { auto m2 = a.borrow_mutable(); }));
+                CHECK(raises(lifetime_violation::modified_during_range, [&] {
+                    auto v = Lifetime<std::vector<int>>::from(std::vector<int>{1});
+                    auto r = v.range();
+                    v.get_mutable();
+                }));
+            }
+        }
+        lifetime_sampling::set_rate(100);
+    }
+#endif
+
+#if defined(LIFETIME_RECORD)
+    auto record_replay() -> void
+    {
+        lifetime_record::start();
+        {
+            auto a = Lifetime<int>::from(1);
+            auto b = a.borrow();
+            a.set(2);
+            CHECK(raises(lifetime_violation::write_without_ownership, [&] { b.set(3); }));
+            auto c = a.move();
+            c.move(a);
+        }
+        lifetime_record::stop();
+        const std::vector<lifetime_record::event> events = lifetime_record::events();
+        CHECK(!events.empty());
+
+        // Round trip through the file format
+        std::stringstream file;
+        lifetime_record::write(file, events);
+        std::vector<lifetime_record::event> loaded;
+        CHECK(lifetime_record::read(file, loaded));
+        CHECK(loaded.size() == events.size() && std::memcmp(loaded.data(), events.data(), events.size() * sizeof(lifetime_record::event)) == 0);
+
+        // Truncated, foreign or lying about its length: rejected
+        const std::string bytes = file.str();
+        std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+        CHECK(!lifetime_record::read(truncated, loaded) && loaded.empty());
+        std::string foreign_bytes = bytes;
+        foreign_bytes[0] = 'X';
+        std::stringstream foreign(foreign_bytes);
+        CHECK(!lifetime_record::read(foreign, loaded));
+        std::string huge_bytes = bytes;
+        const std::uint64_t huge = std::uint64_t(1) << 56U;
+        std::memcpy(&huge_bytes[offsetof(lifetime_record::file_header, count)], &huge, sizeof(huge));
+        std::stringstream huge_count(huge_bytes);
+        CHECK(!lifetime_record::read(huge_count, loaded) && loaded.empty());
+
+        // The replay raises the violation the recording logged
+        lifetime_record::replayer<int> replay;
+        const lifetime_record::replay_result result = replay.run(events);
+        CHECK(result.events == events.size() && result.skipped == 0U);
+        CHECK(result.violations_recorded == 1U && result.violations_raised == 1U);
+    }
+#endif
+}
+
+auto main() -> int {
+
+    ownership();
+    levels();
+    ranges();
+    slices();
+    args();
+    bulk();
+#if defined(LIFETIME_SAMPLED_CHECKS)
+    sampled();
+#endif
+#if defined(LIFETIME_RECORD)
+    record_replay();
+#endif
+
+    std::printf(failures == 0 ? "All checks passed.\n" : "%d checks failed.\n", failures);
+    return failures == 0 ? 0 : 1;
+}